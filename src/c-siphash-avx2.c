@@ -0,0 +1,325 @@
+/*
+ * AVX2 SipHash Kernels
+ *
+ * This implements multi-lane SipHash24 kernels for x86 CPUs with AVX2. Rather
+ * than trying to speed up a single hash, which is a strictly serial chain of
+ * additions, rotations and xors, these kernels hash four independent messages
+ * at the same time. Each of the four state words v0..v3 is kept in a 256bit
+ * register, with one 64bit lane per message.
+ *
+ * The kernels are compiled with function-level target attributes, so the
+ * library itself can still be built for baseline CPUs. Callers must verify
+ * the CPU supports AVX2 before calling into this file.
+ */
+
+#include <c-stdaux.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "c-siphash.h"
+#include "c-siphash-private.h"
+
+#if C_SIPHASH_X86
+
+#include <immintrin.h>
+
+#define C_SIPHASH_AVX2 __attribute__((__target__("avx2")))
+
+#define c_siphash_avx2_rotate_left(_x, _b) \
+        _mm256_or_si256(_mm256_slli_epi64((_x), (_b)), _mm256_srli_epi64((_x), 64 - (_b)))
+
+static inline C_SIPHASH_AVX2 __m256i c_siphash_avx2_rotate_left16(__m256i x) {
+        const __m256i shuffle = _mm256_setr_epi8(6, 7, 0, 1, 2, 3, 4, 5,
+                                                 14, 15, 8, 9, 10, 11, 12, 13,
+                                                 6, 7, 0, 1, 2, 3, 4, 5,
+                                                 14, 15, 8, 9, 10, 11, 12, 13);
+
+        return _mm256_shuffle_epi8(x, shuffle);
+}
+
+static inline C_SIPHASH_AVX2 __m256i c_siphash_avx2_rotate_left32(__m256i x) {
+        return _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline C_SIPHASH_AVX2 void c_siphash_avx2_sipround(__m256i v[4]) {
+        v[0] = _mm256_add_epi64(v[0], v[1]);
+        v[1] = c_siphash_avx2_rotate_left(v[1], 13);
+        v[1] = _mm256_xor_si256(v[1], v[0]);
+        v[0] = c_siphash_avx2_rotate_left32(v[0]);
+        v[2] = _mm256_add_epi64(v[2], v[3]);
+        v[3] = c_siphash_avx2_rotate_left16(v[3]);
+        v[3] = _mm256_xor_si256(v[3], v[2]);
+        v[0] = _mm256_add_epi64(v[0], v[3]);
+        v[3] = c_siphash_avx2_rotate_left(v[3], 21);
+        v[3] = _mm256_xor_si256(v[3], v[0]);
+        v[2] = _mm256_add_epi64(v[2], v[1]);
+        v[1] = c_siphash_avx2_rotate_left(v[1], 17);
+        v[1] = _mm256_xor_si256(v[1], v[2]);
+        v[2] = c_siphash_avx2_rotate_left32(v[2]);
+}
+
+static inline C_SIPHASH_AVX2 void c_siphash_avx2_compress(__m256i v[4], __m256i m) {
+        v[3] = _mm256_xor_si256(v[3], m);
+        c_siphash_avx2_sipround(v);
+        c_siphash_avx2_sipround(v);
+        v[0] = _mm256_xor_si256(v[0], m);
+}
+
+static inline C_SIPHASH_AVX2 __m256i c_siphash_avx2_finalize(__m256i v[4]) {
+        v[2] = _mm256_xor_si256(v[2], _mm256_set1_epi64x(0xff));
+
+        c_siphash_avx2_sipround(v);
+        c_siphash_avx2_sipround(v);
+        c_siphash_avx2_sipround(v);
+        c_siphash_avx2_sipround(v);
+
+        return _mm256_xor_si256(_mm256_xor_si256(v[0], v[1]),
+                                _mm256_xor_si256(v[2], v[3]));
+}
+
+C_SIPHASH_AVX2 void c_siphash_x4_avx2(const uint8_t seed[16],
+                                      const uint8_t *const bytes[4],
+                                      const size_t n_bytes[4],
+                                      uint64_t hashes[4]) {
+        size_t i, j, n_blocks[4], n_min, n_max;
+        uint64_t m[4], active[4];
+        __m256i v[4], w[4], mask;
+        CSipHash state;
+
+        c_siphash_init_inline(&state, seed);
+        v[0] = _mm256_set1_epi64x(state.v0);
+        v[1] = _mm256_set1_epi64x(state.v1);
+        v[2] = _mm256_set1_epi64x(state.v2);
+        v[3] = _mm256_set1_epi64x(state.v3);
+
+        n_min = SIZE_MAX;
+        n_max = 0;
+        for (j = 0; j < 4; ++j) {
+                n_blocks[j] = n_bytes[j] / 8 + 1;
+                n_min = c_min(n_min, n_blocks[j]);
+                n_max = c_max(n_max, n_blocks[j]);
+        }
+
+        /*
+         * As long as no message ran out of blocks, all lanes are busy and we
+         * can compress unconditionally. Up to the last block of the shortest
+         * message, all blocks are plain 64bit words.
+         */
+        for (i = 0; i + 1 < n_min; ++i) {
+                for (j = 0; j < 4; ++j)
+                        m[j] = c_siphash_read_le64(bytes[j] + i * 8);
+
+                c_siphash_avx2_compress(v, _mm256_loadu_si256((const __m256i *)m));
+        }
+
+        for ( ; i < n_min; ++i) {
+                for (j = 0; j < 4; ++j)
+                        m[j] = c_siphash_read_block(bytes[j], n_bytes[j], i);
+
+                c_siphash_avx2_compress(v, _mm256_loadu_si256((const __m256i *)m));
+        }
+
+        /*
+         * Lanes of shorter messages are done, but must not be touched until
+         * all other lanes caught up. Compress all lanes, but only keep the
+         * result of active ones.
+         */
+        for ( ; i < n_max; ++i) {
+                for (j = 0; j < 4; ++j) {
+                        active[j] = (i < n_blocks[j]) ? UINT64_MAX : 0;
+                        m[j] = active[j] ? c_siphash_read_block(bytes[j], n_bytes[j], i) : 0;
+                }
+
+                mask = _mm256_loadu_si256((const __m256i *)active);
+
+                w[0] = v[0];
+                w[1] = v[1];
+                w[2] = v[2];
+                w[3] = v[3];
+                c_siphash_avx2_compress(w, _mm256_loadu_si256((const __m256i *)m));
+                v[0] = _mm256_blendv_epi8(v[0], w[0], mask);
+                v[1] = _mm256_blendv_epi8(v[1], w[1], mask);
+                v[2] = _mm256_blendv_epi8(v[2], w[2], mask);
+                v[3] = _mm256_blendv_epi8(v[3], w[3], mask);
+        }
+
+        _mm256_storeu_si256((__m256i *)hashes, c_siphash_avx2_finalize(v));
+}
+
+/*
+ * The column kernels hash arrays of fixed-size integers. All lanes have the
+ * same length, so they run in lockstep, without any masking. Two registers
+ * of lanes are hashed per iteration, since the SipRounds of a single one are
+ * a dependency chain that leaves most of the vector units idle.
+ */
+C_SIPHASH_AVX2 void c_siphash_column_u64_avx2(const uint8_t seed[16],
+                                              const uint64_t *values,
+                                              size_t n,
+                                              uint64_t *hashes) {
+        const __m256i b = _mm256_set1_epi64x((int64_t)(UINT64_C(8) << 56));
+        __m256i init[4], v[4], w[4], m;
+        CSipHash state;
+        size_t i;
+
+        c_siphash_init_inline(&state, seed);
+        init[0] = _mm256_set1_epi64x(state.v0);
+        init[1] = _mm256_set1_epi64x(state.v1);
+        init[2] = _mm256_set1_epi64x(state.v2);
+        init[3] = _mm256_set1_epi64x(state.v3);
+
+        for (i = 0; i + 8 <= n; i += 8) {
+                memcpy(v, init, sizeof(v));
+                memcpy(w, init, sizeof(w));
+
+                m = _mm256_loadu_si256((const __m256i *)(values + i));
+                c_siphash_avx2_compress(v, m);
+                m = _mm256_loadu_si256((const __m256i *)(values + i + 4));
+                c_siphash_avx2_compress(w, m);
+
+                c_siphash_avx2_compress(v, b);
+                c_siphash_avx2_compress(w, b);
+
+                _mm256_storeu_si256((__m256i *)(hashes + i), c_siphash_avx2_finalize(v));
+                _mm256_storeu_si256((__m256i *)(hashes + i + 4), c_siphash_avx2_finalize(w));
+        }
+
+        for ( ; i < n; ++i)
+                hashes[i] = c_siphash_hash_u64(seed, values[i]);
+}
+
+C_SIPHASH_AVX2 void c_siphash_column_u32_avx2(const uint8_t seed[16],
+                                              const uint32_t *values,
+                                              size_t n,
+                                              uint64_t *hashes) {
+        const __m256i b = _mm256_set1_epi64x((int64_t)(UINT64_C(4) << 56));
+        __m256i init[4], v[4], w[4], m;
+        CSipHash state;
+        size_t i;
+
+        c_siphash_init_inline(&state, seed);
+        init[0] = _mm256_set1_epi64x(state.v0);
+        init[1] = _mm256_set1_epi64x(state.v1);
+        init[2] = _mm256_set1_epi64x(state.v2);
+        init[3] = _mm256_set1_epi64x(state.v3);
+
+        /* a 4 byte message is a single block, with the length on top */
+        for (i = 0; i + 8 <= n; i += 8) {
+                memcpy(v, init, sizeof(v));
+                memcpy(w, init, sizeof(w));
+
+                m = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(values + i)));
+                c_siphash_avx2_compress(v, _mm256_or_si256(m, b));
+                m = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(values + i + 4)));
+                c_siphash_avx2_compress(w, _mm256_or_si256(m, b));
+
+                _mm256_storeu_si256((__m256i *)(hashes + i), c_siphash_avx2_finalize(v));
+                _mm256_storeu_si256((__m256i *)(hashes + i + 4), c_siphash_avx2_finalize(w));
+        }
+
+        for ( ; i < n; ++i)
+                hashes[i] = c_siphash_hash_u32(seed, values[i]);
+}
+
+/*
+ * The strided kernel hashes a field of equal length in an array of records.
+ * Lanes run in lockstep, like the column kernels, but gather their words from
+ * the records. The last block of a field is assembled with scalar code, since
+ * loading a full word could read past the end of the field.
+ */
+C_SIPHASH_AVX2 void c_siphash_strided_avx2(const uint8_t seed[16],
+                                           const uint8_t *bytes,
+                                           size_t stride,
+                                           size_t n_bytes,
+                                           size_t n,
+                                           uint64_t *hashes) {
+        __m256i init[4], v[4], w[4], index0, index1;
+        size_t i, j, k, n_words = n_bytes / 8;
+        const uint8_t *record;
+        CSipHash state;
+        uint64_t m[8];
+
+        c_siphash_init_inline(&state, seed);
+        init[0] = _mm256_set1_epi64x(state.v0);
+        init[1] = _mm256_set1_epi64x(state.v1);
+        init[2] = _mm256_set1_epi64x(state.v2);
+        init[3] = _mm256_set1_epi64x(state.v3);
+
+        index0 = _mm256_setr_epi64x(0, stride, 2 * stride, 3 * stride);
+        index1 = _mm256_add_epi64(index0, _mm256_set1_epi64x(4 * stride));
+
+        for (i = 0; i + 8 <= n; i += 8) {
+                record = bytes + i * stride;
+                memcpy(v, init, sizeof(v));
+                memcpy(w, init, sizeof(w));
+
+                for (k = 0; k < n_words; ++k) {
+                        c_siphash_avx2_compress(v, _mm256_i64gather_epi64((const long long *)(record + k * 8), index0, 1));
+                        c_siphash_avx2_compress(w, _mm256_i64gather_epi64((const long long *)(record + k * 8), index1, 1));
+                }
+
+                for (j = 0; j < 8; ++j)
+                        m[j] = c_siphash_read_block(record + j * stride, n_bytes, n_words);
+
+                c_siphash_avx2_compress(v, _mm256_loadu_si256((const __m256i *)m));
+                c_siphash_avx2_compress(w, _mm256_loadu_si256((const __m256i *)(m + 4)));
+
+                _mm256_storeu_si256((__m256i *)(hashes + i), c_siphash_avx2_finalize(v));
+                _mm256_storeu_si256((__m256i *)(hashes + i + 4), c_siphash_avx2_finalize(w));
+        }
+
+        for ( ; i < n; ++i)
+                hashes[i] = c_siphash_hash_inline(seed, bytes + i * stride, n_bytes);
+}
+
+/*
+ * Hash one message with the keys of @n_regs registers of lanes. Each block
+ * of the message is read once, and broadcast to all lanes.
+ */
+static inline C_SIPHASH_AVX2 void c_siphash_avx2_multikey(const CSipHashKey *keys,
+                                                          size_t n_regs,
+                                                          const uint8_t *bytes,
+                                                          size_t n_bytes,
+                                                          uint64_t *hashes) {
+        size_t i, r, n_words = n_bytes / 8;
+        const CSipHashKey *k;
+        __m256i v[2][4], m;
+
+        for (r = 0; r < n_regs; ++r) {
+                k = keys + r * 4;
+                v[r][0] = _mm256_setr_epi64x(k[0].v0, k[1].v0, k[2].v0, k[3].v0);
+                v[r][1] = _mm256_setr_epi64x(k[0].v1, k[1].v1, k[2].v1, k[3].v1);
+                v[r][2] = _mm256_setr_epi64x(k[0].v2, k[1].v2, k[2].v2, k[3].v2);
+                v[r][3] = _mm256_setr_epi64x(k[0].v3, k[1].v3, k[2].v3, k[3].v3);
+        }
+
+        for (i = 0; i < n_words; ++i) {
+                m = _mm256_set1_epi64x(c_siphash_read_le64(bytes + i * 8));
+                for (r = 0; r < n_regs; ++r)
+                        c_siphash_avx2_compress(v[r], m);
+        }
+
+        m = _mm256_set1_epi64x(c_siphash_read_block(bytes, n_bytes, n_words));
+        for (r = 0; r < n_regs; ++r) {
+                c_siphash_avx2_compress(v[r], m);
+                _mm256_storeu_si256((__m256i *)(hashes + r * 4), c_siphash_avx2_finalize(v[r]));
+        }
+}
+
+C_SIPHASH_AVX2 void c_siphash_multikey_avx2(const CSipHashKey *keys,
+                                            size_t n_keys,
+                                            const uint8_t *bytes,
+                                            size_t n_bytes,
+                                            uint64_t *hashes) {
+        size_t i;
+
+        for (i = 0; i + 8 <= n_keys; i += 8)
+                c_siphash_avx2_multikey(keys + i, 2, bytes, n_bytes, hashes + i);
+
+        for ( ; i + 4 <= n_keys; i += 4)
+                c_siphash_avx2_multikey(keys + i, 1, bytes, n_bytes, hashes + i);
+
+        for ( ; i < n_keys; ++i)
+                hashes[i] = c_siphash_hash_key(&keys[i], bytes, n_bytes);
+}
+
+#endif /* C_SIPHASH_X86 */
@@ -0,0 +1,307 @@
+/*
+ * AVX-512 SipHash Kernels
+ *
+ * This implements multi-lane SipHash24 kernels for x86 CPUs with AVX-512F.
+ * Like the AVX2 kernels, these hash independent messages in parallel, but
+ * with eight 64bit lanes per register. AVX-512F provides a native 64bit
+ * rotation, so each rotation of the SipRound is a single instruction, and
+ * opmask registers allow lanes to retire without any blending.
+ *
+ * The kernels are compiled with function-level target attributes, so the
+ * library itself can still be built for baseline CPUs. Callers must verify
+ * the CPU supports AVX-512F before calling into this file.
+ */
+
+#include <c-stdaux.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "c-siphash.h"
+#include "c-siphash-private.h"
+
+#if C_SIPHASH_X86
+
+#include <immintrin.h>
+
+#define C_SIPHASH_AVX512 __attribute__((__target__("avx512f")))
+
+static inline C_SIPHASH_AVX512 void c_siphash_avx512_sipround(__m512i v[4]) {
+        v[0] = _mm512_add_epi64(v[0], v[1]);
+        v[1] = _mm512_rol_epi64(v[1], 13);
+        v[1] = _mm512_xor_si512(v[1], v[0]);
+        v[0] = _mm512_rol_epi64(v[0], 32);
+        v[2] = _mm512_add_epi64(v[2], v[3]);
+        v[3] = _mm512_rol_epi64(v[3], 16);
+        v[3] = _mm512_xor_si512(v[3], v[2]);
+        v[0] = _mm512_add_epi64(v[0], v[3]);
+        v[3] = _mm512_rol_epi64(v[3], 21);
+        v[3] = _mm512_xor_si512(v[3], v[0]);
+        v[2] = _mm512_add_epi64(v[2], v[1]);
+        v[1] = _mm512_rol_epi64(v[1], 17);
+        v[1] = _mm512_xor_si512(v[1], v[2]);
+        v[2] = _mm512_rol_epi64(v[2], 32);
+}
+
+static inline C_SIPHASH_AVX512 void c_siphash_avx512_compress(__m512i v[4], __m512i m) {
+        v[3] = _mm512_xor_si512(v[3], m);
+        c_siphash_avx512_sipround(v);
+        c_siphash_avx512_sipround(v);
+        v[0] = _mm512_xor_si512(v[0], m);
+}
+
+static inline C_SIPHASH_AVX512 __m512i c_siphash_avx512_finalize(__m512i v[4]) {
+        v[2] = _mm512_xor_si512(v[2], _mm512_set1_epi64(0xff));
+
+        c_siphash_avx512_sipround(v);
+        c_siphash_avx512_sipround(v);
+        c_siphash_avx512_sipround(v);
+        c_siphash_avx512_sipround(v);
+
+        return _mm512_xor_si512(_mm512_xor_si512(v[0], v[1]),
+                                _mm512_xor_si512(v[2], v[3]));
+}
+
+C_SIPHASH_AVX512 void c_siphash_x8_avx512(const uint8_t seed[16],
+                                          const uint8_t *const bytes[8],
+                                          const size_t n_bytes[8],
+                                          uint64_t hashes[8]) {
+        size_t i, j, n_blocks[8], n_min, n_max;
+        __m512i v[4], w[4];
+        CSipHash state;
+        uint64_t m[8];
+        __mmask8 k;
+
+        c_siphash_init_inline(&state, seed);
+        v[0] = _mm512_set1_epi64(state.v0);
+        v[1] = _mm512_set1_epi64(state.v1);
+        v[2] = _mm512_set1_epi64(state.v2);
+        v[3] = _mm512_set1_epi64(state.v3);
+
+        n_min = SIZE_MAX;
+        n_max = 0;
+        for (j = 0; j < 8; ++j) {
+                n_blocks[j] = n_bytes[j] / 8 + 1;
+                n_min = c_min(n_min, n_blocks[j]);
+                n_max = c_max(n_max, n_blocks[j]);
+        }
+
+        /*
+         * As long as no message ran out of blocks, all lanes are busy and we
+         * can compress unconditionally. Up to the last block of the shortest
+         * message, all blocks are plain 64bit words.
+         */
+        for (i = 0; i + 1 < n_min; ++i) {
+                for (j = 0; j < 8; ++j)
+                        m[j] = c_siphash_read_le64(bytes[j] + i * 8);
+
+                c_siphash_avx512_compress(v, _mm512_loadu_si512(m));
+        }
+
+        for ( ; i < n_min; ++i) {
+                for (j = 0; j < 8; ++j)
+                        m[j] = c_siphash_read_block(bytes[j], n_bytes[j], i);
+
+                c_siphash_avx512_compress(v, _mm512_loadu_si512(m));
+        }
+
+        /*
+         * Lanes of shorter messages are done. Keep compressing the others,
+         * but use the opmask to only update the state of active lanes.
+         */
+        for ( ; i < n_max; ++i) {
+                k = 0;
+                for (j = 0; j < 8; ++j) {
+                        if (i < n_blocks[j]) {
+                                k |= 1U << j;
+                                m[j] = c_siphash_read_block(bytes[j], n_bytes[j], i);
+                        } else {
+                                m[j] = 0;
+                        }
+                }
+
+                w[0] = v[0];
+                w[1] = v[1];
+                w[2] = v[2];
+                w[3] = v[3];
+                c_siphash_avx512_compress(w, _mm512_loadu_si512(m));
+                v[0] = _mm512_mask_mov_epi64(v[0], k, w[0]);
+                v[1] = _mm512_mask_mov_epi64(v[1], k, w[1]);
+                v[2] = _mm512_mask_mov_epi64(v[2], k, w[2]);
+                v[3] = _mm512_mask_mov_epi64(v[3], k, w[3]);
+        }
+
+        _mm512_storeu_si512(hashes, c_siphash_avx512_finalize(v));
+}
+
+/*
+ * See the AVX2 column kernels for details. These hash two registers of eight
+ * lanes per iteration.
+ */
+C_SIPHASH_AVX512 void c_siphash_column_u64_avx512(const uint8_t seed[16],
+                                                  const uint64_t *values,
+                                                  size_t n,
+                                                  uint64_t *hashes) {
+        const __m512i b = _mm512_set1_epi64((int64_t)(UINT64_C(8) << 56));
+        __m512i init[4], v[4], w[4], m;
+        CSipHash state;
+        size_t i;
+
+        c_siphash_init_inline(&state, seed);
+        init[0] = _mm512_set1_epi64(state.v0);
+        init[1] = _mm512_set1_epi64(state.v1);
+        init[2] = _mm512_set1_epi64(state.v2);
+        init[3] = _mm512_set1_epi64(state.v3);
+
+        for (i = 0; i + 16 <= n; i += 16) {
+                memcpy(v, init, sizeof(v));
+                memcpy(w, init, sizeof(w));
+
+                m = _mm512_loadu_si512((const void *)(values + i));
+                c_siphash_avx512_compress(v, m);
+                m = _mm512_loadu_si512((const void *)(values + i + 8));
+                c_siphash_avx512_compress(w, m);
+
+                c_siphash_avx512_compress(v, b);
+                c_siphash_avx512_compress(w, b);
+
+                _mm512_storeu_si512((void *)(hashes + i), c_siphash_avx512_finalize(v));
+                _mm512_storeu_si512((void *)(hashes + i + 8), c_siphash_avx512_finalize(w));
+        }
+
+        for ( ; i < n; ++i)
+                hashes[i] = c_siphash_hash_u64(seed, values[i]);
+}
+
+C_SIPHASH_AVX512 void c_siphash_column_u32_avx512(const uint8_t seed[16],
+                                                  const uint32_t *values,
+                                                  size_t n,
+                                                  uint64_t *hashes) {
+        const __m512i b = _mm512_set1_epi64((int64_t)(UINT64_C(4) << 56));
+        __m512i init[4], v[4], w[4], m;
+        CSipHash state;
+        size_t i;
+
+        c_siphash_init_inline(&state, seed);
+        init[0] = _mm512_set1_epi64(state.v0);
+        init[1] = _mm512_set1_epi64(state.v1);
+        init[2] = _mm512_set1_epi64(state.v2);
+        init[3] = _mm512_set1_epi64(state.v3);
+
+        for (i = 0; i + 16 <= n; i += 16) {
+                memcpy(v, init, sizeof(v));
+                memcpy(w, init, sizeof(w));
+
+                m = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *)(values + i)));
+                c_siphash_avx512_compress(v, _mm512_or_si512(m, b));
+                m = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *)(values + i + 8)));
+                c_siphash_avx512_compress(w, _mm512_or_si512(m, b));
+
+                _mm512_storeu_si512((void *)(hashes + i), c_siphash_avx512_finalize(v));
+                _mm512_storeu_si512((void *)(hashes + i + 8), c_siphash_avx512_finalize(w));
+        }
+
+        for ( ; i < n; ++i)
+                hashes[i] = c_siphash_hash_u32(seed, values[i]);
+}
+
+/* see the AVX2 strided kernel for details */
+C_SIPHASH_AVX512 void c_siphash_strided_avx512(const uint8_t seed[16],
+                                               const uint8_t *bytes,
+                                               size_t stride,
+                                               size_t n_bytes,
+                                               size_t n,
+                                               uint64_t *hashes) {
+        __m512i init[4], v[4], w[4], index0, index1;
+        size_t i, j, k, n_words = n_bytes / 8;
+        const uint8_t *record;
+        CSipHash state;
+        uint64_t m[16];
+
+        c_siphash_init_inline(&state, seed);
+        init[0] = _mm512_set1_epi64(state.v0);
+        init[1] = _mm512_set1_epi64(state.v1);
+        init[2] = _mm512_set1_epi64(state.v2);
+        init[3] = _mm512_set1_epi64(state.v3);
+
+        index0 = _mm512_setr_epi64(0, stride, 2 * stride, 3 * stride,
+                                   4 * stride, 5 * stride, 6 * stride, 7 * stride);
+        index1 = _mm512_add_epi64(index0, _mm512_set1_epi64(8 * stride));
+
+        for (i = 0; i + 16 <= n; i += 16) {
+                record = bytes + i * stride;
+                memcpy(v, init, sizeof(v));
+                memcpy(w, init, sizeof(w));
+
+                for (k = 0; k < n_words; ++k) {
+                        c_siphash_avx512_compress(v, _mm512_i64gather_epi64(index0, record + k * 8, 1));
+                        c_siphash_avx512_compress(w, _mm512_i64gather_epi64(index1, record + k * 8, 1));
+                }
+
+                for (j = 0; j < 16; ++j)
+                        m[j] = c_siphash_read_block(record + j * stride, n_bytes, n_words);
+
+                c_siphash_avx512_compress(v, _mm512_loadu_si512((const void *)m));
+                c_siphash_avx512_compress(w, _mm512_loadu_si512((const void *)(m + 8)));
+
+                _mm512_storeu_si512((void *)(hashes + i), c_siphash_avx512_finalize(v));
+                _mm512_storeu_si512((void *)(hashes + i + 8), c_siphash_avx512_finalize(w));
+        }
+
+        for ( ; i < n; ++i)
+                hashes[i] = c_siphash_hash_inline(seed, bytes + i * stride, n_bytes);
+}
+
+/* see the AVX2 multi-key kernel for details */
+static inline C_SIPHASH_AVX512 void c_siphash_avx512_multikey(const CSipHashKey *keys,
+                                                              size_t n_regs,
+                                                              const uint8_t *bytes,
+                                                              size_t n_bytes,
+                                                              uint64_t *hashes) {
+        size_t i, r, n_words = n_bytes / 8;
+        const CSipHashKey *k;
+        __m512i v[2][4], m;
+
+        for (r = 0; r < n_regs; ++r) {
+                k = keys + r * 8;
+                v[r][0] = _mm512_setr_epi64(k[0].v0, k[1].v0, k[2].v0, k[3].v0,
+                                            k[4].v0, k[5].v0, k[6].v0, k[7].v0);
+                v[r][1] = _mm512_setr_epi64(k[0].v1, k[1].v1, k[2].v1, k[3].v1,
+                                            k[4].v1, k[5].v1, k[6].v1, k[7].v1);
+                v[r][2] = _mm512_setr_epi64(k[0].v2, k[1].v2, k[2].v2, k[3].v2,
+                                            k[4].v2, k[5].v2, k[6].v2, k[7].v2);
+                v[r][3] = _mm512_setr_epi64(k[0].v3, k[1].v3, k[2].v3, k[3].v3,
+                                            k[4].v3, k[5].v3, k[6].v3, k[7].v3);
+        }
+
+        for (i = 0; i < n_words; ++i) {
+                m = _mm512_set1_epi64(c_siphash_read_le64(bytes + i * 8));
+                for (r = 0; r < n_regs; ++r)
+                        c_siphash_avx512_compress(v[r], m);
+        }
+
+        m = _mm512_set1_epi64(c_siphash_read_block(bytes, n_bytes, n_words));
+        for (r = 0; r < n_regs; ++r) {
+                c_siphash_avx512_compress(v[r], m);
+                _mm512_storeu_si512((void *)(hashes + r * 8), c_siphash_avx512_finalize(v[r]));
+        }
+}
+
+C_SIPHASH_AVX512 void c_siphash_multikey_avx512(const CSipHashKey *keys,
+                                                size_t n_keys,
+                                                const uint8_t *bytes,
+                                                size_t n_bytes,
+                                                uint64_t *hashes) {
+        size_t i;
+
+        for (i = 0; i + 16 <= n_keys; i += 16)
+                c_siphash_avx512_multikey(keys + i, 2, bytes, n_bytes, hashes + i);
+
+        for ( ; i + 8 <= n_keys; i += 8)
+                c_siphash_avx512_multikey(keys + i, 1, bytes, n_bytes, hashes + i);
+
+        /* the remaining keys fit the AVX2 kernel, which we can rely on */
+        if (i < n_keys)
+                c_siphash_multikey_avx2(keys + i, n_keys - i, bytes, n_bytes, hashes + i);
+}
+
+#endif /* C_SIPHASH_X86 */
@@ -0,0 +1,280 @@
+/*
+ * Batch Calibration
+ *
+ * Whether a multi-lane kernel beats hashing messages one by one depends on
+ * the message length, as well as on the micro-architecture. Wide kernels
+ * have to assemble their input from several messages, and CPUs with many
+ * scalar execution units overlap independent scalar hashes almost as well.
+ *
+ * This implements an optional calibration, which measures all kernels of
+ * the selected implementation for a set of representative message lengths,
+ * and tunes batch hashing to use the fastest for each length class. The
+ * result can be stored in a small cache file, to avoid repeating the
+ * measurements every time a service is started.
+ */
+
+#include <c-stdaux.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "c-siphash.h"
+#include "c-siphash-private.h"
+
+#define C_SIPHASH_CALIBRATE_N_MESSAGES 64
+#define C_SIPHASH_CALIBRATE_N_RUNS 5
+#define C_SIPHASH_CALIBRATE_MAGIC "c-siphash-calibration-1"
+
+/* representative message length of each length class */
+static const size_t c_siphash_calibrate_lengths[C_SIPHASH_N_LENGTH_CLASSES] = {
+        4, 12, 24, 48, 96, 192, 384,
+};
+
+static uint64_t c_siphash_calibrate_now(void) {
+        struct timespec ts;
+        int r;
+
+        r = clock_gettime(CLOCK_MONOTONIC, &ts);
+        c_assert(r >= 0);
+
+        return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Measure the time it takes to hash the given messages in groups of @lanes,
+ * using the kernels of @impl. This returns the best of several runs, to
+ * reduce the effect of interrupts and frequency changes.
+ */
+static uint64_t c_siphash_calibrate_run(const CSipHashImpl *impl,
+                                        size_t lanes,
+                                        const uint8_t *const *bytes,
+                                        const size_t *n_bytes) {
+        static const uint8_t seed[16] = {};
+        uint64_t hashes[C_SIPHASH_CALIBRATE_N_MESSAGES];
+        uint64_t start, t, best = UINT64_MAX;
+        size_t i, run;
+
+        for (run = 0; run < C_SIPHASH_CALIBRATE_N_RUNS; ++run) {
+                start = c_siphash_calibrate_now();
+
+                for (i = 0; i < C_SIPHASH_CALIBRATE_N_MESSAGES; i += lanes) {
+                        switch (lanes) {
+                        case 8:
+                                impl->hash_x8(seed, bytes + i, n_bytes + i, hashes + i);
+                                break;
+                        case 4:
+                                impl->hash_x4(seed, bytes + i, n_bytes + i, hashes + i);
+                                break;
+                        case 2:
+                                impl->hash_x2(seed, bytes + i, n_bytes + i, hashes + i);
+                                break;
+                        default:
+                                hashes[i] = c_siphash_hash_inline(seed, bytes[i], n_bytes[i]);
+                                break;
+                        }
+                }
+
+                t = c_siphash_calibrate_now() - start;
+                best = c_min(best, t);
+
+                /* make sure the hashes are not optimized away */
+                __asm__ __volatile__("" : : "r" (hashes) : "memory");
+        }
+
+        return best;
+}
+
+static void c_siphash_calibrate_measure(const CSipHashImpl *impl, uint8_t lanes[C_SIPHASH_N_LENGTH_CLASSES]) {
+        uint8_t data[512];
+        const uint8_t *bytes[C_SIPHASH_CALIBRATE_N_MESSAGES];
+        size_t i, c, l, n_bytes[C_SIPHASH_CALIBRATE_N_MESSAGES];
+        uint64_t t, best;
+
+        for (i = 0; i < sizeof(data); ++i)
+                data[i] = i * 7;
+
+        for (c = 0; c < C_SIPHASH_N_LENGTH_CLASSES; ++c) {
+                for (i = 0; i < C_SIPHASH_CALIBRATE_N_MESSAGES; ++i) {
+                        bytes[i] = data + (i * 8) % 128;
+                        n_bytes[i] = c_siphash_calibrate_lengths[c];
+                }
+
+                lanes[c] = 1;
+                best = c_siphash_calibrate_run(impl, 1, bytes, n_bytes);
+
+                for (l = 2; l <= impl->n_lanes; l *= 2) {
+                        t = c_siphash_calibrate_run(impl, l, bytes, n_bytes);
+                        if (t < best) {
+                                lanes[c] = l;
+                                best = t;
+                        }
+                }
+        }
+}
+
+static bool c_siphash_calibrate_valid(const CSipHashImpl *impl, unsigned int lanes) {
+        return (lanes == 1 || lanes == 2 || lanes == 4 || lanes == 8) && lanes <= impl->n_lanes;
+}
+
+/*
+ * Read the calibration from @path. This returns 0 on success, or a negative
+ * error code if the file could not be read. If the file does not contain a
+ * valid calibration for @impl, -EINVAL is returned.
+ */
+static int c_siphash_calibrate_load(const CSipHashImpl *impl,
+                                    const char *path,
+                                    uint8_t lanes[C_SIPHASH_N_LENGTH_CLASSES]) {
+        char magic[32], name[32];
+        unsigned int v;
+        size_t c;
+        FILE *f;
+        int r;
+
+        f = fopen(path, "re");
+        if (!f)
+                return -c_errno();
+
+        r = fscanf(f, "%31s %31s", magic, name);
+        if (r != 2 || strcmp(magic, C_SIPHASH_CALIBRATE_MAGIC) || strcmp(name, impl->name)) {
+                fclose(f);
+                return -EINVAL;
+        }
+
+        for (c = 0; c < C_SIPHASH_N_LENGTH_CLASSES; ++c) {
+                r = fscanf(f, "%u", &v);
+                if (r != 1 || !c_siphash_calibrate_valid(impl, v)) {
+                        fclose(f);
+                        return -EINVAL;
+                }
+
+                lanes[c] = v;
+        }
+
+        fclose(f);
+        return 0;
+}
+
+/*
+ * Write the calibration to @path. The file is written to a temporary file in
+ * the same directory first, and then renamed over @path. Hence, concurrent
+ * loaders either see the old file or the new one, but never a partial one,
+ * even if several processes calibrate at the same time or one of them dies
+ * while writing.
+ */
+static int c_siphash_calibrate_store(const CSipHashImpl *impl,
+                                     const char *path,
+                                     const uint8_t lanes[C_SIPHASH_N_LENGTH_CLASSES]) {
+        char *tmp;
+        size_t c;
+        FILE *f;
+        int r, fd;
+
+        tmp = malloc(strlen(path) + sizeof(".XXXXXX"));
+        if (!tmp)
+                return -ENOMEM;
+
+        strcpy(tmp, path);
+        strcat(tmp, ".XXXXXX");
+
+        fd = mkostemp(tmp, O_CLOEXEC);
+        if (fd < 0) {
+                r = -c_errno();
+                free(tmp);
+                return r;
+        }
+
+        /* mkostemp() creates the file private, but the cache can be shared */
+        if (fchmod(fd, 0644) < 0) {
+                r = -c_errno();
+                goto error;
+        }
+
+        f = fdopen(fd, "w");
+        if (!f) {
+                r = -c_errno();
+                goto error;
+        }
+
+        fprintf(f, "%s %s", C_SIPHASH_CALIBRATE_MAGIC, impl->name);
+        for (c = 0; c < C_SIPHASH_N_LENGTH_CLASSES; ++c)
+                fprintf(f, " %u", (unsigned int)lanes[c]);
+        fprintf(f, "\n");
+
+        if (ferror(f)) {
+                fclose(f);
+                r = -EIO;
+                goto error_unlink;
+        }
+
+        if (fclose(f)) {
+                r = -c_errno();
+                goto error_unlink;
+        }
+
+        if (rename(tmp, path) < 0) {
+                r = -c_errno();
+                goto error_unlink;
+        }
+
+        free(tmp);
+        return 0;
+
+error:
+        close(fd);
+error_unlink:
+        unlink(tmp);
+        free(tmp);
+        return r;
+}
+
+/**
+ * c_siphash_calibrate() - tune batch hashing for the running machine
+ * @cache_path:         path to calibration cache, or NULL
+ *
+ * By default, batch hashing always uses the widest multi-lane kernel the CPU
+ * supports. This calibrates batch hashing instead: for a set of message
+ * length classes, it measures all available kernels, as well as hashing the
+ * messages one by one, and makes batch hashing use the fastest for each
+ * class. This takes about a millisecond.
+ *
+ * If @cache_path is non-NULL, the calibration is read from that file, if it
+ * contains a valid calibration for the selected kernels. Otherwise, the
+ * measurements are run, and their result is written to @cache_path. The file
+ * is replaced atomically, so concurrent callers never read a partial file. It
+ * is small, and can be safely deleted at any time.
+ *
+ * The calibration has no effect on the hash values. Hence, it is safe to call
+ * this while other threads are hashing, even though it is meant to be called
+ * once at startup.
+ *
+ * Return: 0 on success, negative error code if @cache_path could not be
+ *         written. The calibration is applied in both cases.
+ */
+_c_public_ int c_siphash_calibrate(const char *cache_path) {
+        const CSipHashImpl *impl = c_siphash_impl_get();
+        uint8_t lanes[C_SIPHASH_N_LENGTH_CLASSES];
+        int r;
+
+        if (cache_path) {
+                r = c_siphash_calibrate_load(impl, cache_path, lanes);
+                if (!r) {
+                        c_siphash_impl_tune(lanes);
+                        return 0;
+                }
+        }
+
+        c_siphash_calibrate_measure(impl, lanes);
+        c_siphash_impl_tune(lanes);
+
+        if (cache_path)
+                return c_siphash_calibrate_store(impl, cache_path, lanes);
+
+        return 0;
+}
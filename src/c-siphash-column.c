@@ -0,0 +1,275 @@
+/*
+ * Column Hashing
+ *
+ * Analytics engines store columns of values in a few contiguous buffers,
+ * rather than as individual objects. This implements hashing of entire
+ * columns straight from such layouts, which are those of the Apache Arrow
+ * columnar format. All rows are hashed with the same seed, so they are fed
+ * into the multi-lane kernels, just like c_siphash_hash_batch() does.
+ */
+
+#include <c-stdaux.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "c-siphash.h"
+#include "c-siphash-private.h"
+
+static inline bool c_siphash_column_valid(const uint8_t *validity, size_t i) {
+        return !validity || (validity[i / 8] & (1U << (i % 8)));
+}
+
+/**
+ * c_siphash_hash_column_varlen() - hash column of variable-length values
+ * @seed:               128bit seed
+ * @data:               data buffer of the column
+ * @offsets:            array of @n + 1 offsets into @data
+ * @n:                  number of rows
+ * @validity:           validity bitmap of the column, or NULL
+ * @hashes:             output array for the @n 64bit hash values
+ *
+ * This produces the SipHash24 hash values of the @n rows of a column of
+ * variable-length binary values or strings. The value of row i is stored in
+ * @data, starting at offset @offsets[i], and ending before offset
+ * @offsets[i + 1]. Offsets must be non-decreasing, but do not have to start
+ * at 0, so slices of a column can be hashed in place.
+ *
+ * If @validity is non-NULL, it is a bitmap of @n bits, with bit i % 8 of byte
+ * i / 8 set, if row i is valid. The hash value of invalid rows is
+ * C_SIPHASH_COLUMN_NULL_HASH, regardless of their offsets. Valid rows can
+ * hash to the same value, so callers must consult @validity, rather than the
+ * hash value, to tell NULL rows apart. The hash value of all valid rows is
+ * identical to calling c_siphash_hash() on them:
+ *
+ *         for (i = 0; i < n; ++i)
+ *                 hashes[i] = c_siphash_hash(seed,
+ *                                            data + offsets[i],
+ *                                            offsets[i + 1] - offsets[i]);
+ *
+ * Like c_siphash_hash_batch(), this hashes rows of similar lengths in groups
+ * using the multi-lane kernels, and reads them directly from @data. Instead
+ * of finalizing one row before starting on the next, the kernels keep several
+ * rows in flight, so their rounds overlap in the CPU pipeline. The kernels
+ * take arrays of pointers and lengths, though, so these are built for 256
+ * rows at a time, on the stack.
+ */
+_c_public_ void c_siphash_hash_column_varlen(const uint8_t seed[16],
+                                             const uint8_t *data,
+                                             const uint32_t *offsets,
+                                             size_t n,
+                                             const uint8_t *validity,
+                                             uint64_t *hashes) {
+        const CSipHashImpl *impl = c_siphash_impl_get();
+        const uint8_t *bytes[C_SIPHASH_BATCH_CHUNK];
+        size_t n_bytes[C_SIPHASH_BATCH_CHUNK];
+        uint64_t chunk_hashes[C_SIPHASH_BATCH_CHUNK];
+        uint16_t rows[C_SIPHASH_BATCH_CHUNK];
+        size_t i, j, n_chunk, n_valid;
+
+        for (i = 0; i < n; i += n_chunk) {
+                n_chunk = c_min(n - i, (size_t)C_SIPHASH_BATCH_CHUNK);
+
+                /*
+                 * Collect the valid rows of the chunk. Only the kernels take
+                 * pointer arrays, so they are built for one chunk at a time,
+                 * on the stack.
+                 */
+                n_valid = 0;
+                for (j = 0; j < n_chunk; ++j) {
+                        if (!c_siphash_column_valid(validity, i + j)) {
+                                hashes[i + j] = C_SIPHASH_COLUMN_NULL_HASH;
+                                continue;
+                        }
+
+                        bytes[n_valid] = data + offsets[i + j];
+                        n_bytes[n_valid] = offsets[i + j + 1] - offsets[i + j];
+                        rows[n_valid] = j;
+                        ++n_valid;
+                }
+
+                if (n_valid == n_chunk) {
+                        c_siphash_hash_chunk(impl, seed, bytes, n_bytes, n_chunk, hashes + i);
+                        continue;
+                }
+
+                c_siphash_hash_chunk(impl, seed, bytes, n_bytes, n_valid, chunk_hashes);
+                for (j = 0; j < n_valid; ++j)
+                        hashes[i + rows[j]] = chunk_hashes[j];
+        }
+}
+
+/**
+ * c_siphash_hash_column_u64() - hash column of 64bit integers
+ * @seed:               128bit seed
+ * @values:             array of @n integers
+ * @n:                  number of integers
+ * @hashes:             output array for the @n 64bit hash values
+ *
+ * This produces the SipHash24 hash values of the little-endian
+ * representation of each integer in @values. The result is identical to
+ * calling c_siphash_hash_u64() on each of them:
+ *
+ *         for (i = 0; i < n; ++i)
+ *                 hashes[i] = c_siphash_hash_u64(seed, values[i]);
+ *
+ * All messages have the same length, so the AVX2 and AVX-512 kernels run all
+ * lanes in lockstep, without any of the bookkeeping of variable-length
+ * batches.
+ */
+_c_public_ void c_siphash_hash_column_u64(const uint8_t seed[16],
+                                          const uint64_t *values,
+                                          size_t n,
+                                          uint64_t *hashes) {
+        c_siphash_impl_get()->hash_column_u64(seed, values, n, hashes);
+}
+
+/**
+ * c_siphash_hash_column_u32() - hash column of 32bit integers
+ * @seed:               128bit seed
+ * @values:             array of @n integers
+ * @n:                  number of integers
+ * @hashes:             output array for the @n 64bit hash values
+ *
+ * This is the 32bit equivalent of c_siphash_hash_column_u64(). Each integer
+ * is hashed as its 4 little-endian bytes, like c_siphash_hash_u32() does.
+ */
+_c_public_ void c_siphash_hash_column_u32(const uint8_t seed[16],
+                                          const uint32_t *values,
+                                          size_t n,
+                                          uint64_t *hashes) {
+        c_siphash_impl_get()->hash_column_u32(seed, values, n, hashes);
+}
+
+/**
+ * c_siphash_hash_strided() - hash field of each record in an array
+ * @seed:               128bit seed
+ * @base:               pointer to the first record
+ * @stride:             size of each record, in bytes
+ * @field_offset:       offset of the field in each record, in bytes
+ * @field_len:          length of the field, in bytes
+ * @n:                  number of records
+ * @hashes:             output array for the @n 64bit hash values
+ *
+ * This produces the SipHash24 hash values of the field at @field_offset of
+ * each of the @n records in the array at @base, in place. The result is
+ * identical to calling c_siphash_hash() on each field:
+ *
+ *         for (i = 0; i < n; ++i)
+ *                 hashes[i] = c_siphash_hash(seed,
+ *                                            base + i * stride + field_offset,
+ *                                            field_len);
+ *
+ * No bytes outside of the fields are read. Fields of all records have the
+ * same length, so the AVX2 and AVX-512 kernels run all lanes in lockstep,
+ * and use gather loads to read the fields of several records at once.
+ */
+_c_public_ void c_siphash_hash_strided(const uint8_t seed[16],
+                                       const void *base,
+                                       size_t stride,
+                                       size_t field_offset,
+                                       size_t field_len,
+                                       size_t n,
+                                       uint64_t *hashes) {
+        c_siphash_impl_get()->hash_strided(seed,
+                                           (const uint8_t *)base + field_offset,
+                                           stride,
+                                           field_len,
+                                           n,
+                                           hashes);
+}
+
+/*
+ * Append the fixed-width field at @bytes to @state. Common integer widths
+ * are fed via the typed appends, which never fall back to single bytes.
+ */
+static inline void c_siphash_column_append(CSipHash *state, const uint8_t *bytes, size_t width) {
+        switch (width) {
+        case 8:
+                c_siphash_append_u64(state, c_siphash_read_le64(bytes));
+                break;
+        case 4:
+                c_siphash_append_u32(state, (uint32_t)bytes[0] |
+                                            ((uint32_t)bytes[1] << 8) |
+                                            ((uint32_t)bytes[2] << 16) |
+                                            ((uint32_t)bytes[3] << 24));
+                break;
+        case 2:
+                c_siphash_append_u16(state, (uint16_t)(bytes[0] | (bytes[1] << 8)));
+                break;
+        case 1:
+                c_siphash_append_u8(state, bytes[0]);
+                break;
+        default:
+                c_siphash_append_inline(state, bytes, width);
+                break;
+        }
+}
+
+/**
+ * c_siphash_hash_rows() - hash rows of multiple columns
+ * @seed:               128bit seed
+ * @columns:            array of @n_columns column descriptors
+ * @n_columns:          number of columns
+ * @n:                  number of rows
+ * @hashes:             output array for the @n 64bit hash values
+ *
+ * This produces the SipHash24 hash values of @n rows, each made of one field
+ * of every column in @columns, in order. This is meant for composite keys of
+ * group-by and join operations. A fixed-width column stores its fields back
+ * to back in @data, each @width bytes long. A variable-length column has
+ * non-NULL @offsets, and stores its fields like described for
+ * c_siphash_hash_column_varlen().
+ *
+ * The hash value of a row is defined as c_siphash_hash() of the concatenated
+ * encoding of its fields. A fixed-width field is encoded as its bytes, a
+ * variable-length field as its length as 64bit little-endian integer,
+ * followed by its bytes. The length prefix makes sure that moving bytes
+ * between adjacent fields changes the hash value.
+ *
+ * The encoding is never materialized. Instead, the rows are processed in
+ * batches, which keep one CSipHash state per row. Each column is appended to
+ * all states of a batch before the next column, so columns are read
+ * sequentially. This is not faster than serializing each row into a buffer
+ * and hashing it, but it needs no such buffer.
+ */
+_c_public_ void c_siphash_hash_rows(const uint8_t seed[16],
+                                    const CSipHashColumn *columns,
+                                    size_t n_columns,
+                                    size_t n,
+                                    uint64_t *hashes) {
+        CSipHash states[C_SIPHASH_ROWS_BATCH];
+        const CSipHashColumn *column;
+        size_t i, j, c, n_batch, len;
+        CSipHashKey key;
+
+        c_siphash_key_init_inline(&key, seed);
+
+        for (i = 0; i < n; i += n_batch) {
+                n_batch = c_min(n - i, (size_t)C_SIPHASH_ROWS_BATCH);
+
+                for (j = 0; j < n_batch; ++j)
+                        c_siphash_init_key_inline(&states[j], &key);
+
+                for (c = 0; c < n_columns; ++c) {
+                        column = &columns[c];
+
+                        if (column->offsets) {
+                                for (j = 0; j < n_batch; ++j) {
+                                        len = column->offsets[i + j + 1] - column->offsets[i + j];
+                                        c_siphash_append_u64(&states[j], len);
+                                        c_siphash_append_inline(&states[j],
+                                                                column->data + column->offsets[i + j],
+                                                                len);
+                                }
+                        } else {
+                                for (j = 0; j < n_batch; ++j)
+                                        c_siphash_column_append(&states[j],
+                                                                column->data + (i + j) * column->width,
+                                                                column->width);
+                        }
+                }
+
+                for (j = 0; j < n_batch; ++j)
+                        hashes[i + j] = c_siphash_finalize_inline(&states[j]);
+        }
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+/*
+ * Inline Core
+ * This file contains the SipHash core as static inline functions. The library
+ * and its CPU-specific kernels are built from it. It is also installed, since
+ * the C_SIPHASH_INLINE mode of c-siphash.h provides the core API from it.
+ * Nothing in here is API, and it can change at any time.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "c-siphash.h"
+
+static inline uint64_t c_siphash_read_le64(const uint8_t bytes[8]) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        uint64_t v;
+
+        /* unaligned native load, which compilers turn into a single mov */
+        memcpy(&v, bytes, sizeof(v));
+        return v;
+#else
+        return  ((uint64_t) bytes[0]) |
+               (((uint64_t) bytes[1]) <<  8) |
+               (((uint64_t) bytes[2]) << 16) |
+               (((uint64_t) bytes[3]) << 24) |
+               (((uint64_t) bytes[4]) << 32) |
+               (((uint64_t) bytes[5]) << 40) |
+               (((uint64_t) bytes[6]) << 48) |
+               (((uint64_t) bytes[7]) << 56);
+#endif
+}
+
+static inline uint64_t c_siphash_rotate_left(uint64_t x, uint8_t b) {
+        return (x << b) | (x >> (64 - b));
+}
+
+static inline void c_siphash_sipround(CSipHash *state) {
+        state->v0 += state->v1;
+        state->v1 = c_siphash_rotate_left(state->v1, 13);
+        state->v1 ^= state->v0;
+        state->v0 = c_siphash_rotate_left(state->v0, 32);
+        state->v2 += state->v3;
+        state->v3 = c_siphash_rotate_left(state->v3, 16);
+        state->v3 ^= state->v2;
+        state->v0 += state->v3;
+        state->v3 = c_siphash_rotate_left(state->v3, 21);
+        state->v3 ^= state->v0;
+        state->v2 += state->v1;
+        state->v1 = c_siphash_rotate_left(state->v1, 17);
+        state->v1 ^= state->v2;
+        state->v2 = c_siphash_rotate_left(state->v2, 32);
+}
+
+static inline void c_siphash_compress_rounds(CSipHash *state, uint64_t m, unsigned int c_rounds) {
+        unsigned int i;
+
+        state->v3 ^= m;
+        for (i = 0; i < c_rounds; ++i)
+                c_siphash_sipround(state);
+        state->v0 ^= m;
+}
+
+static inline void c_siphash_compress(CSipHash *state, uint64_t m) {
+        c_siphash_compress_rounds(state, m, 2);
+}
+
+/**
+ * c_siphash_append_word() - hash integer
+ * @state:              context object
+ * @v:                  integer to hash
+ * @n_bytes:            number of low-order bytes of @v to hash, at most 8
+ *
+ * This feeds the @n_bytes low-order bytes of @v into the SipHash state
+ * machine, in little-endian order. All higher-order bytes of @v must be 0.
+ *
+ * Unlike c_siphash_append(), this never operates on single bytes. Instead, @v
+ * is shifted into the pending bytes of @state, and the resulting 64bit chunk
+ * is hashed once it is complete.
+ */
+static inline void c_siphash_append_word(CSipHash *state, uint64_t v, size_t n_bytes) {
+        size_t left = state->n_bytes & 7;
+
+        state->n_bytes += n_bytes;
+        state->padding |= v << (left * 8);
+
+        if (left + n_bytes >= 8) {
+                c_siphash_compress(state, state->padding);
+                state->padding = left ? v >> ((8 - left) * 8) : 0;
+        }
+}
+
+/*
+ * These are the implementations of the core API. The exported symbols are
+ * thin wrappers around them, see c-siphash.c for their documentation.
+ */
+
+static inline void c_siphash_key_init_inline(CSipHashKey *key, const uint8_t seed[16]) {
+        uint64_t k0, k1;
+
+        k0 = c_siphash_read_le64(seed);
+        k1 = c_siphash_read_le64(seed + 8);
+
+        /*
+         * Default seed is taken from the reference implementation of
+         * SipHash24 ("somepseudorandomlygeneratedbytes"). Callers are still
+         * recommended to provide proper seeds themselves.
+         */
+        key->v0 = 0x736f6d6570736575ULL ^ k0;
+        key->v1 = 0x646f72616e646f6dULL ^ k1;
+        key->v2 = 0x6c7967656e657261ULL ^ k0;
+        key->v3 = 0x7465646279746573ULL ^ k1;
+}
+
+static inline void c_siphash_init_key_inline(CSipHash *state, const CSipHashKey *key) {
+        state->v0 = key->v0;
+        state->v1 = key->v1;
+        state->v2 = key->v2;
+        state->v3 = key->v3;
+        state->padding = 0;
+        state->n_bytes = 0;
+}
+
+static inline void c_siphash_init_inline(CSipHash *state, const uint8_t seed[16]) {
+        CSipHashKey key;
+
+        c_siphash_key_init_inline(&key, seed);
+        c_siphash_init_key_inline(state, &key);
+}
+
+/*
+ * Read @n_bytes < 8 bytes as little-endian integer. This uses at most three
+ * loads, rather than one per byte.
+ */
+static inline uint64_t c_siphash_read_tail(const uint8_t *bytes, size_t n_bytes) {
+        uint64_t v = 0;
+        size_t shift = 0;
+
+        /* compilers merge these into single loads on little-endian CPUs */
+        if (n_bytes & 4) {
+                v = ((uint64_t) bytes[0]) |
+                    (((uint64_t) bytes[1]) <<  8) |
+                    (((uint64_t) bytes[2]) << 16) |
+                    (((uint64_t) bytes[3]) << 24);
+                bytes += 4;
+                shift = 32;
+        }
+
+        if (n_bytes & 2) {
+                v |= (((uint64_t) bytes[0]) | (((uint64_t) bytes[1]) << 8)) << shift;
+                bytes += 2;
+                shift += 16;
+        }
+
+        if (n_bytes & 1)
+                v |= (uint64_t)bytes[0] << shift;
+
+        return v;
+}
+
+/*
+ * The SipHash-c-d family differs only in the number of SipRounds per
+ * compression (c) and finalization (d). The variants are generated from
+ * these rounds-parametrized bodies, which the compiler specializes for the
+ * constant round counts.
+ *
+ * If @map is non-NULL, every word of the input is passed through it before
+ * it is hashed, including the trailing bytes, padded with zero bytes. It must
+ * transform each byte on its own, and keep zero bytes zero. Callers pass a
+ * constant, so the compiler inlines it into the word loop.
+ */
+static inline void c_siphash_append_map(CSipHash *state,
+                                        const uint8_t *bytes,
+                                        size_t n_bytes,
+                                        unsigned int c_rounds,
+                                        uint64_t (*map) (uint64_t)) {
+        size_t left = state->n_bytes & 7, shift = left * 8;
+        uint64_t m, carry = state->padding;
+
+        state->n_bytes += n_bytes;
+
+        /*
+         * SipHash operates on 64bit chunks. If the stream is at a 64bit
+         * boundary, the words of the input are exactly those chunks, and are
+         * compressed as they are. The trailing bytes are kept in @padding, so
+         * the next round (or the finalizer) get access to them.
+         */
+        if (left == 0) {
+                for ( ; n_bytes >= 8; bytes += 8, n_bytes -= 8) {
+                        m = c_siphash_read_le64(bytes);
+                        c_siphash_compress_rounds(state, map ? map(m) : m, c_rounds);
+                }
+
+                m = c_siphash_read_tail(bytes, n_bytes);
+                state->padding = carry | (map ? map(m) : m);
+                return;
+        }
+
+        /*
+         * Otherwise, @left bytes of the previous blob are pending in
+         * @padding, and every word of the input straddles two chunks. Rather
+         * than completing the pending chunk byte by byte, shift each word
+         * into place, and carry its upper bytes into the next chunk.
+         */
+        for ( ; n_bytes >= 8; bytes += 8, n_bytes -= 8) {
+                m = c_siphash_read_le64(bytes);
+                m = map ? map(m) : m;
+                c_siphash_compress_rounds(state, carry | (m << shift), c_rounds);
+                carry = m >> (64 - shift);
+        }
+
+        m = c_siphash_read_tail(bytes, n_bytes);
+        m = map ? map(m) : m;
+        if (left + n_bytes >= 8) {
+                c_siphash_compress_rounds(state, carry | (m << shift), c_rounds);
+                carry = m >> (64 - shift);
+        } else {
+                carry |= m << shift;
+        }
+
+        state->padding = carry;
+}
+
+static inline void c_siphash_append_rounds(CSipHash *state, const uint8_t *bytes, size_t n_bytes, unsigned int c_rounds) {
+        c_siphash_append_map(state, bytes, n_bytes, c_rounds, NULL);
+}
+
+static inline uint64_t c_siphash_finalize_rounds(CSipHash *state, unsigned int c_rounds, unsigned int d_rounds) {
+        unsigned int i;
+        uint64_t b;
+
+        b = state->padding | (((uint64_t) state->n_bytes) << 56);
+
+        c_siphash_compress_rounds(state, b, c_rounds);
+
+        state->v2 ^= 0xff;
+
+        for (i = 0; i < d_rounds; ++i)
+                c_siphash_sipround(state);
+
+        return state->v0 ^ state->v1 ^ state->v2  ^ state->v3;
+}
+
+static inline void c_siphash_append_inline(CSipHash *state, const uint8_t *bytes, size_t n_bytes) {
+        c_siphash_append_rounds(state, bytes, n_bytes, 2);
+}
+
+static inline uint64_t c_siphash_finalize_inline(CSipHash *state) {
+        return c_siphash_finalize_rounds(state, 2, 4);
+}
+
+static inline uint64_t c_siphash_hash_key_inline(const CSipHashKey *key, const uint8_t *bytes, size_t n_bytes) {
+        CSipHash state;
+
+        c_siphash_init_key_inline(&state, key);
+        c_siphash_append_inline(&state, bytes, n_bytes);
+
+        return c_siphash_finalize_inline(&state);
+}
+
+static inline uint64_t c_siphash_hash_inline(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes) {
+        CSipHash state;
+
+        c_siphash_init_inline(&state, seed);
+        c_siphash_append_inline(&state, bytes, n_bytes);
+
+        return c_siphash_finalize_inline(&state);
+}
+
+#ifdef __cplusplus
+}
+#endif
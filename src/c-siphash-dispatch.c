@@ -0,0 +1,278 @@
+/*
+ * Kernel Dispatch
+ *
+ * The multi-lane kernels require CPU features that are not part of the
+ * baseline the library is compiled for. This selects the best set of kernels
+ * supported by the running CPU, exactly once, when the library is loaded.
+ * All multi-lane entry points then call through the selected table.
+ *
+ * Note that single-message hashing is not dispatched. SipHash is a serial
+ * chain of dependent operations, which no SIMD unit can shorten, so the
+ * generic implementation of c_siphash_hash() is used on all CPUs.
+ */
+
+#include <c-stdaux.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "c-siphash.h"
+#include "c-siphash-private.h"
+
+static const CSipHashImpl *c_siphash_impl;
+static uint8_t c_siphash_lanes[C_SIPHASH_N_LENGTH_CLASSES];
+
+static void c_siphash_xn_generic(size_t n,
+                                 const uint8_t seed[16],
+                                 const uint8_t *const *bytes,
+                                 const size_t *n_bytes,
+                                 uint64_t *hashes) {
+        size_t i;
+
+        for (i = 0; i < n; ++i)
+                hashes[i] = c_siphash_hash_inline(seed, bytes[i], n_bytes[i]);
+}
+
+static void c_siphash_x2_generic(const uint8_t seed[16],
+                                 const uint8_t *const *bytes,
+                                 const size_t *n_bytes,
+                                 uint64_t *hashes) {
+        c_siphash_xn_generic(2, seed, bytes, n_bytes, hashes);
+}
+
+static void c_siphash_x4_generic(const uint8_t seed[16],
+                                 const uint8_t *const *bytes,
+                                 const size_t *n_bytes,
+                                 uint64_t *hashes) {
+        c_siphash_xn_generic(4, seed, bytes, n_bytes, hashes);
+}
+
+static void c_siphash_x8_generic(const uint8_t seed[16],
+                                 const uint8_t *const *bytes,
+                                 const size_t *n_bytes,
+                                 uint64_t *hashes) {
+        c_siphash_xn_generic(8, seed, bytes, n_bytes, hashes);
+}
+
+static void c_siphash_column_u64_generic(const uint8_t seed[16],
+                                         const uint64_t *values,
+                                         size_t n,
+                                         uint64_t *hashes) {
+        size_t i;
+
+        for (i = 0; i < n; ++i)
+                hashes[i] = c_siphash_hash_u64(seed, values[i]);
+}
+
+static void c_siphash_column_u32_generic(const uint8_t seed[16],
+                                         const uint32_t *values,
+                                         size_t n,
+                                         uint64_t *hashes) {
+        size_t i;
+
+        for (i = 0; i < n; ++i)
+                hashes[i] = c_siphash_hash_u32(seed, values[i]);
+}
+
+static void c_siphash_strided_generic(const uint8_t seed[16],
+                                      const uint8_t *bytes,
+                                      size_t stride,
+                                      size_t n_bytes,
+                                      size_t n,
+                                      uint64_t *hashes) {
+        size_t i;
+
+        for (i = 0; i < n; ++i)
+                hashes[i] = c_siphash_hash_inline(seed, bytes + i * stride, n_bytes);
+}
+
+static void c_siphash_multikey_generic(const CSipHashKey *keys,
+                                       size_t n_keys,
+                                       const uint8_t *bytes,
+                                       size_t n_bytes,
+                                       uint64_t *hashes) {
+        size_t i;
+
+        for (i = 0; i < n_keys; ++i)
+                hashes[i] = c_siphash_hash_key(&keys[i], bytes, n_bytes);
+}
+
+static bool c_siphash_supported_generic(void) {
+        return true;
+}
+
+#if C_SIPHASH_X86
+
+static void c_siphash_x8_avx2(const uint8_t seed[16],
+                              const uint8_t *const *bytes,
+                              const size_t *n_bytes,
+                              uint64_t *hashes) {
+        c_siphash_x4_avx2(seed, bytes, n_bytes, hashes);
+        c_siphash_x4_avx2(seed, bytes + 4, n_bytes + 4, hashes + 4);
+}
+
+static bool c_siphash_supported_sse2(void) {
+        return __builtin_cpu_supports("sse2");
+}
+
+static bool c_siphash_supported_avx2(void) {
+        return __builtin_cpu_supports("avx2");
+}
+
+static bool c_siphash_supported_avx512(void) {
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2");
+}
+
+#endif /* C_SIPHASH_X86 */
+
+/*
+ * All available implementations, ordered by preference. The generic
+ * implementation must be last, since it is supported everywhere.
+ *
+ * Note that the two-lane SSE2 kernel is slower than two scalar hashes on
+ * CPUs that are wide enough to overlap them, which includes all CPUs with
+ * AVX2. Hence, it is only used by the SSE2 implementation.
+ */
+const CSipHashImpl c_siphash_impls[] = {
+#if C_SIPHASH_X86
+        {
+                .name = "avx512",
+                .supported = c_siphash_supported_avx512,
+                .n_lanes = 8,
+                .hash_x2 = c_siphash_x2_generic,
+                .hash_x4 = c_siphash_x4_avx2,
+                .hash_x8 = c_siphash_x8_avx512,
+                .hash_column_u64 = c_siphash_column_u64_avx512,
+                .hash_column_u32 = c_siphash_column_u32_avx512,
+                .hash_strided = c_siphash_strided_avx512,
+                .hash_multikey = c_siphash_multikey_avx512,
+        },
+        {
+                .name = "avx2",
+                .supported = c_siphash_supported_avx2,
+                .n_lanes = 4,
+                .hash_x2 = c_siphash_x2_generic,
+                .hash_x4 = c_siphash_x4_avx2,
+                .hash_x8 = c_siphash_x8_avx2,
+                .hash_column_u64 = c_siphash_column_u64_avx2,
+                .hash_column_u32 = c_siphash_column_u32_avx2,
+                .hash_strided = c_siphash_strided_avx2,
+                .hash_multikey = c_siphash_multikey_avx2,
+        },
+        {
+                .name = "sse2",
+                .supported = c_siphash_supported_sse2,
+                .n_lanes = 2,
+                .hash_x2 = c_siphash_x2_sse2,
+                .hash_x4 = c_siphash_x4_generic,
+                .hash_x8 = c_siphash_x8_generic,
+                .hash_column_u64 = c_siphash_column_u64_generic,
+                .hash_column_u32 = c_siphash_column_u32_generic,
+                .hash_strided = c_siphash_strided_generic,
+                .hash_multikey = c_siphash_multikey_generic,
+        },
+#endif
+        {
+                .name = "generic",
+                .supported = c_siphash_supported_generic,
+                .n_lanes = 1,
+                .hash_x2 = c_siphash_x2_generic,
+                .hash_x4 = c_siphash_x4_generic,
+                .hash_x8 = c_siphash_x8_generic,
+                .hash_column_u64 = c_siphash_column_u64_generic,
+                .hash_column_u32 = c_siphash_column_u32_generic,
+                .hash_strided = c_siphash_strided_generic,
+                .hash_multikey = c_siphash_multikey_generic,
+        },
+};
+
+const size_t c_siphash_n_impls = C_ARRAY_SIZE(c_siphash_impls);
+
+static const CSipHashImpl *c_siphash_impl_select(void) {
+        size_t i;
+
+#if C_SIPHASH_X86
+        __builtin_cpu_init();
+#endif
+
+        for (i = 0; i < c_siphash_n_impls; ++i)
+                if (c_siphash_impls[i].supported())
+                        return &c_siphash_impls[i];
+
+        return &c_siphash_impls[c_siphash_n_impls - 1];
+}
+
+/*
+ * Select the implementation when the library is loaded, so the entry points
+ * never pay for it. If another constructor calls into the library before
+ * this ran, c_siphash_impl_get() selects it on demand. The selection is
+ * deterministic, so racing callers store the same value.
+ */
+__attribute__((__constructor__)) static void c_siphash_impl_init(void) {
+        __atomic_store_n(&c_siphash_impl, c_siphash_impl_select(), __ATOMIC_RELEASE);
+}
+
+const CSipHashImpl *c_siphash_impl_get(void) {
+        const CSipHashImpl *impl;
+
+        impl = __atomic_load_n(&c_siphash_impl, __ATOMIC_ACQUIRE);
+        if (_c_unlikely_(!impl)) {
+                impl = c_siphash_impl_select();
+                __atomic_store_n(&c_siphash_impl, impl, __ATOMIC_RELEASE);
+        }
+
+        return impl;
+}
+
+/*
+ * Override the selected implementation. This is used by the test-suite to
+ * run all kernels supported by the CPU, not just the preferred ones. It must
+ * not be used while other threads hash data.
+ */
+void c_siphash_impl_set(const CSipHashImpl *impl) {
+        c_assert(impl->supported());
+
+        __atomic_store_n(&c_siphash_impl, impl, __ATOMIC_RELEASE);
+        c_siphash_impl_tune(NULL);
+}
+
+/*
+ * Return the number of lanes batch hashing should use for a group of
+ * messages of at most @n_bytes bytes. Unless tuned otherwise, this is the
+ * widest kernel of the implementation.
+ */
+size_t c_siphash_impl_lanes(const CSipHashImpl *impl, size_t n_bytes) {
+        size_t lanes;
+
+        lanes = __atomic_load_n(&c_siphash_lanes[c_siphash_length_class(n_bytes)], __ATOMIC_RELAXED);
+        if (!lanes)
+                return impl->n_lanes;
+
+        return c_min(lanes, impl->n_lanes);
+}
+
+/*
+ * Set the number of lanes to use for each length class, or reset them to
+ * the default if @lanes is NULL. Hashes do not depend on the number of
+ * lanes, so concurrent batch hashing is safe, but may pick either value.
+ */
+void c_siphash_impl_tune(const uint8_t *lanes) {
+        size_t i;
+
+        for (i = 0; i < C_SIPHASH_N_LENGTH_CLASSES; ++i)
+                __atomic_store_n(&c_siphash_lanes[i], lanes ? lanes[i] : 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * c_siphash_get_implementation() - query name of the selected kernels
+ *
+ * When the library is loaded, it selects the multi-lane kernels best suited
+ * for the running CPU. This returns the name of that selection, which is one
+ * of "avx512", "avx2", "sse2", or "generic". The name is meant for logging and
+ * diagnostics. It has no effect on the hash values, which are identical with
+ * all kernels.
+ *
+ * Return: Static string naming the selected kernels.
+ */
+_c_public_ const char *c_siphash_get_implementation(void) {
+        return c_siphash_impl_get()->name;
+}
@@ -0,0 +1,253 @@
+/*
+ * HalfSipHash Implementation
+ *
+ * HalfSipHash is the 32bit sibling of SipHash. It works on a state of four
+ * 32bit words, takes a 64bit seed, and produces 32bit or 64bit hashes. It is
+ * meant for hash tables on 32bit CPUs, where every 64bit operation of SipHash
+ * costs two instructions, and for tables that only need 32bit hashes.
+ *
+ * This implements HalfSipHash-2-4, based on the reference implementation of
+ * Jean-Philippe Aumasson, released to the Public Domain. The API follows the
+ * streaming API of CSipHash.
+ */
+
+#include <c-stdaux.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "c-siphash.h"
+
+static inline uint32_t c_siphash_half_read_le32(const uint8_t bytes[4]) {
+        return  ((uint32_t) bytes[0]) |
+               (((uint32_t) bytes[1]) <<  8) |
+               (((uint32_t) bytes[2]) << 16) |
+               (((uint32_t) bytes[3]) << 24);
+}
+
+static inline uint32_t c_siphash_half_rotate_left(uint32_t x, uint8_t b) {
+        return (x << b) | (x >> (32 - b));
+}
+
+static inline void c_siphash_half_sipround(CSipHashHalf *state) {
+        state->v0 += state->v1;
+        state->v1 = c_siphash_half_rotate_left(state->v1, 5);
+        state->v1 ^= state->v0;
+        state->v0 = c_siphash_half_rotate_left(state->v0, 16);
+        state->v2 += state->v3;
+        state->v3 = c_siphash_half_rotate_left(state->v3, 8);
+        state->v3 ^= state->v2;
+        state->v0 += state->v3;
+        state->v3 = c_siphash_half_rotate_left(state->v3, 7);
+        state->v3 ^= state->v0;
+        state->v2 += state->v1;
+        state->v1 = c_siphash_half_rotate_left(state->v1, 13);
+        state->v1 ^= state->v2;
+        state->v2 = c_siphash_half_rotate_left(state->v2, 16);
+}
+
+static inline void c_siphash_half_compress(CSipHashHalf *state, uint32_t m) {
+        state->v3 ^= m;
+        c_siphash_half_sipround(state);
+        c_siphash_half_sipround(state);
+        state->v0 ^= m;
+}
+
+static inline void c_siphash_half_finalize_rounds(CSipHashHalf *state) {
+        c_siphash_half_sipround(state);
+        c_siphash_half_sipround(state);
+        c_siphash_half_sipround(state);
+        c_siphash_half_sipround(state);
+}
+
+/**
+ * c_siphash_half_init() - initialize HalfSipHash context
+ * @state:              context object
+ * @seed:               64bit seed
+ *
+ * This initializes the HalfSipHash state context for 32bit output. It works
+ * like c_siphash_init(), but takes a 64bit seed. To feed data into it, use
+ * c_siphash_half_append(). To get the final hash, use
+ * c_siphash_half_finalize().
+ */
+_c_public_ void c_siphash_half_init(CSipHashHalf *state, const uint8_t seed[8]) {
+        uint32_t k0, k1;
+
+        k0 = c_siphash_half_read_le32(seed);
+        k1 = c_siphash_half_read_le32(seed + 4);
+
+        *state = (CSipHashHalf) {
+                /*
+                 * Unlike SipHash, the reference implementation of HalfSipHash
+                 * uses zero constants for v0 and v1, and the lower halves of
+                 * the SipHash constants for v2 and v3.
+                 */
+                .v0 = k0,
+                .v1 = k1,
+                .v2 = 0x6c796765UL ^ k0,
+                .v3 = 0x74656462UL ^ k1,
+                .padding = 0,
+                .n_bytes = 0,
+        };
+}
+
+/**
+ * c_siphash_half_init64() - initialize HalfSipHash context for 64bit output
+ * @state:              context object
+ * @seed:               64bit seed
+ *
+ * This initializes the HalfSipHash state context for 64bit output. It must be
+ * finalized via c_siphash_half_finalize64(). As with c_siphash_init128(), the
+ * output mode affects the initial state, so it cannot be changed later on.
+ */
+_c_public_ void c_siphash_half_init64(CSipHashHalf *state, const uint8_t seed[8]) {
+        c_siphash_half_init(state, seed);
+        state->v1 ^= 0xee;
+}
+
+/**
+ * c_siphash_half_append() - hash stream of data
+ * @state:              context object
+ * @bytes:              array of input bytes
+ * @n_bytes:            number of input bytes
+ *
+ * This is the HalfSipHash equivalent of c_siphash_append(). HalfSipHash
+ * operates on 32bit chunks, so it works best with chunk-sizes of multiples of
+ * 4 bytes.
+ */
+_c_public_ void c_siphash_half_append(CSipHashHalf *state, const uint8_t *bytes, size_t n_bytes) {
+        const uint8_t *end = bytes + n_bytes;
+        size_t left = state->n_bytes & 3;
+        uint32_t m;
+
+        state->n_bytes += n_bytes;
+
+        /*
+         * If the previous blob was not a multiple of 32bit in length, we must
+         * first complete the pending chunk byte by byte.
+         */
+        if (left > 0) {
+                for ( ; bytes < end && left < 4; ++bytes, ++left)
+                        state->padding |= ((uint32_t) *bytes) << (left * 8);
+
+                if (bytes == end && left < 4)
+                        return;
+
+                c_siphash_half_compress(state, state->padding);
+                state->padding = 0;
+        }
+
+        end -= (state->n_bytes % sizeof(uint32_t));
+
+        for ( ; bytes < end; bytes += 4) {
+                m = c_siphash_half_read_le32(bytes);
+                c_siphash_half_compress(state, m);
+        }
+
+        /* remember the remaining trailing bytes in @padding */
+        left = state->n_bytes & 3;
+        switch (left) {
+                case 3:
+                        state->padding |= ((uint32_t) bytes[2]) << 16;
+                        /* fallthrough */
+                case 2:
+                        state->padding |= ((uint32_t) bytes[1]) <<  8;
+                        /* fallthrough */
+                case 1:
+                        state->padding |= ((uint32_t) bytes[0]);
+                        /* fallthrough */
+                case 0:
+                        break;
+        }
+}
+
+static void c_siphash_half_finalize_block(CSipHashHalf *state) {
+        uint32_t b;
+
+        b = state->padding | (((uint32_t) state->n_bytes) << 24);
+        c_siphash_half_compress(state, b);
+}
+
+/**
+ * c_siphash_half_finalize() - finalize hash
+ * @state:              context object
+ *
+ * This produces the final HalfSipHash-2-4 hash value for the given state,
+ * which must have been initialized via c_siphash_half_init(). Like with
+ * c_siphash_finalize(), @state is invalid after this function returns.
+ *
+ * Return: 32bit hash value
+ */
+_c_public_ uint32_t c_siphash_half_finalize(CSipHashHalf *state) {
+        c_siphash_half_finalize_block(state);
+
+        state->v2 ^= 0xff;
+        c_siphash_half_finalize_rounds(state);
+
+        return state->v1 ^ state->v3;
+}
+
+/**
+ * c_siphash_half_finalize64() - finalize 64bit hash
+ * @state:              context object
+ *
+ * This produces the final 64bit HalfSipHash-2-4 hash value for the given
+ * state, which must have been initialized via c_siphash_half_init64(). The
+ * little-endian representation of the returned value matches the byte output
+ * of the reference implementation.
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash_half_finalize64(CSipHashHalf *state) {
+        uint32_t b0, b1;
+
+        c_siphash_half_finalize_block(state);
+
+        state->v2 ^= 0xee;
+        c_siphash_half_finalize_rounds(state);
+        b0 = state->v1 ^ state->v3;
+
+        state->v1 ^= 0xdd;
+        c_siphash_half_finalize_rounds(state);
+        b1 = state->v1 ^ state->v3;
+
+        return ((uint64_t) b1 << 32) | b0;
+}
+
+/**
+ * c_siphash_half_hash() - hash data blob
+ * @seed:               64bit seed
+ * @bytes:              byte array to hash
+ * @n_bytes:            number of bytes to hash
+ *
+ * This produces the 32bit HalfSipHash-2-4 hash value for the input @bytes /
+ * @n_bytes, using the seed provided as @seed.
+ *
+ * Return: 32bit hash value
+ */
+_c_public_ uint32_t c_siphash_half_hash(const uint8_t seed[8], const uint8_t *bytes, size_t n_bytes) {
+        CSipHashHalf state;
+
+        c_siphash_half_init(&state, seed);
+        c_siphash_half_append(&state, bytes, n_bytes);
+
+        return c_siphash_half_finalize(&state);
+}
+
+/**
+ * c_siphash_half_hash64() - hash data blob with 64bit output
+ * @seed:               64bit seed
+ * @bytes:              byte array to hash
+ * @n_bytes:            number of bytes to hash
+ *
+ * This produces the 64bit HalfSipHash-2-4 hash value for the input @bytes /
+ * @n_bytes, using the seed provided as @seed.
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash_half_hash64(const uint8_t seed[8], const uint8_t *bytes, size_t n_bytes) {
+        CSipHashHalf state;
+
+        c_siphash_half_init64(&state, seed);
+        c_siphash_half_append(&state, bytes, n_bytes);
+
+        return c_siphash_half_finalize64(&state);
+}
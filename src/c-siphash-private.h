@@ -0,0 +1,157 @@
+#pragma once
+
+/*
+ * Private definitions
+ * This file contains private definitions for the SipHash implementation, which
+ * are shared between the generic code and the CPU-specific kernels, and are
+ * used by our test-suite. It pulls in the inline core from c-siphash-core.h.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "c-siphash.h"
+#include "c-siphash-core.h"
+
+typedef struct CSipHashImpl CSipHashImpl;
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  define C_SIPHASH_X86 1
+#else
+#  define C_SIPHASH_X86 0
+#endif
+
+/*
+ * SipHash consumes a message of @n_bytes bytes as @n_bytes / 8 + 1 blocks of
+ * 64bit each. All but the last block are read verbatim from the message. The
+ * last block carries the trailing bytes, as well as the low 8 bits of the
+ * message length in its most significant byte.
+ *
+ * This returns block @i of such a message. Multi-lane kernels use it to feed
+ * messages of unequal length block by block.
+ */
+static inline uint64_t c_siphash_read_block(const uint8_t *bytes, size_t n_bytes, size_t i) {
+        uint64_t b;
+        size_t j;
+
+        bytes += i * 8;
+
+        if (i < n_bytes / 8)
+                return c_siphash_read_le64(bytes);
+
+        b = ((uint64_t) n_bytes) << 56;
+        for (j = 0; j < (n_bytes & 7); ++j)
+                b |= ((uint64_t) bytes[j]) << (j * 8);
+
+        return b;
+}
+
+/* kernels */
+
+typedef void (*CSipHashLanesFn) (const uint8_t seed[16],
+                                 const uint8_t *const *bytes,
+                                 const size_t *n_bytes,
+                                 uint64_t *hashes);
+
+typedef void (*CSipHashColumnU64Fn) (const uint8_t seed[16],
+                                     const uint64_t *values,
+                                     size_t n,
+                                     uint64_t *hashes);
+typedef void (*CSipHashColumnU32Fn) (const uint8_t seed[16],
+                                     const uint32_t *values,
+                                     size_t n,
+                                     uint64_t *hashes);
+typedef void (*CSipHashStridedFn) (const uint8_t seed[16],
+                                   const uint8_t *bytes,
+                                   size_t stride,
+                                   size_t n_bytes,
+                                   size_t n,
+                                   uint64_t *hashes);
+typedef void (*CSipHashMultikeyFn) (const CSipHashKey *keys,
+                                    size_t n_keys,
+                                    const uint8_t *bytes,
+                                    size_t n_bytes,
+                                    uint64_t *hashes);
+
+#if C_SIPHASH_X86
+void c_siphash_x2_sse2(const uint8_t seed[16], const uint8_t *const bytes[2], const size_t n_bytes[2], uint64_t hashes[2]);
+void c_siphash_x4_avx2(const uint8_t seed[16], const uint8_t *const bytes[4], const size_t n_bytes[4], uint64_t hashes[4]);
+void c_siphash_x8_avx512(const uint8_t seed[16], const uint8_t *const bytes[8], const size_t n_bytes[8], uint64_t hashes[8]);
+void c_siphash_column_u64_avx2(const uint8_t seed[16], const uint64_t *values, size_t n, uint64_t *hashes);
+void c_siphash_column_u32_avx2(const uint8_t seed[16], const uint32_t *values, size_t n, uint64_t *hashes);
+void c_siphash_column_u64_avx512(const uint8_t seed[16], const uint64_t *values, size_t n, uint64_t *hashes);
+void c_siphash_column_u32_avx512(const uint8_t seed[16], const uint32_t *values, size_t n, uint64_t *hashes);
+void c_siphash_strided_avx2(const uint8_t seed[16], const uint8_t *bytes, size_t stride, size_t n_bytes, size_t n, uint64_t *hashes);
+void c_siphash_strided_avx512(const uint8_t seed[16], const uint8_t *bytes, size_t stride, size_t n_bytes, size_t n, uint64_t *hashes);
+void c_siphash_multikey_avx2(const CSipHashKey *keys, size_t n_keys, const uint8_t *bytes, size_t n_bytes, uint64_t *hashes);
+void c_siphash_multikey_avx512(const CSipHashKey *keys, size_t n_keys, const uint8_t *bytes, size_t n_bytes, uint64_t *hashes);
+#endif
+
+/* dispatch */
+
+#define C_SIPHASH_N_LENGTH_CLASSES 7
+
+/* number of blobs batch hashing buckets by length at a time, on the stack */
+#define C_SIPHASH_BATCH_CHUNK 256
+
+/* number of rows row hashing keeps states for at a time, on the stack */
+#define C_SIPHASH_ROWS_BATCH 64
+
+/*
+ * Batch hashing picks the number of lanes per group depending on the length
+ * of the messages in the group. For that, message lengths are grouped in
+ * classes of powers of two: [0, 8), [8, 16), [16, 32), ..., [256, inf).
+ */
+static inline size_t c_siphash_length_class(size_t n_bytes) {
+        size_t c = 0;
+
+        for (n_bytes /= 8; n_bytes > 0 && c + 1 < C_SIPHASH_N_LENGTH_CLASSES; n_bytes /= 2)
+                ++c;
+
+        return c;
+}
+
+/**
+ * struct CSipHashImpl - set of kernels for a class of CPUs
+ * @name:               name of the implementation, as reported to the user
+ * @supported:          function to check whether the running CPU supports it
+ * @n_lanes:            number of lanes batch hashing should use
+ * @hash_x2:            kernel to hash two blobs
+ * @hash_x4:            kernel to hash four blobs
+ * @hash_x8:            kernel to hash eight blobs
+ * @hash_column_u64:    kernel to hash an array of 64bit integers
+ * @hash_column_u32:    kernel to hash an array of 32bit integers
+ * @hash_strided:       kernel to hash a field in an array of records
+ * @hash_multikey:      kernel to hash a blob with multiple keys
+ *
+ * Every implementation provides all kernels, using the fastest code it has
+ * available for each of them. The multi-lane entry points simply forward to
+ * the kernels of the implementation selected at load time.
+ */
+struct CSipHashImpl {
+        const char *name;
+        bool (*supported) (void);
+        size_t n_lanes;
+        CSipHashLanesFn hash_x2;
+        CSipHashLanesFn hash_x4;
+        CSipHashLanesFn hash_x8;
+        CSipHashColumnU64Fn hash_column_u64;
+        CSipHashColumnU32Fn hash_column_u32;
+        CSipHashStridedFn hash_strided;
+        CSipHashMultikeyFn hash_multikey;
+};
+
+extern const CSipHashImpl c_siphash_impls[];
+extern const size_t c_siphash_n_impls;
+
+const CSipHashImpl *c_siphash_impl_get(void);
+void c_siphash_impl_set(const CSipHashImpl *impl);
+size_t c_siphash_impl_lanes(const CSipHashImpl *impl, size_t n_bytes);
+void c_siphash_impl_tune(const uint8_t *lanes);
+
+void c_siphash_hash_chunk(const CSipHashImpl *impl,
+                          const uint8_t seed[16],
+                          const uint8_t *const *bytes,
+                          const size_t *n_bytes,
+                          size_t n,
+                          uint64_t *hashes);
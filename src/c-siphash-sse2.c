@@ -0,0 +1,145 @@
+/*
+ * SSE2 SipHash Kernels
+ *
+ * This implements multi-lane SipHash24 kernels for x86 CPUs with SSE2, which
+ * includes every x86-64 CPU. Two independent messages are hashed in parallel,
+ * with one 64bit lane per message. SSE2 has no 64bit rotation, so rotations
+ * are emulated with shifts, except for rotations by 16 and 32, which are
+ * plain word shuffles.
+ *
+ * The kernels are compiled with function-level target attributes, so the
+ * library can still be built for i386 CPUs without SSE2. Callers must verify
+ * the CPU supports SSE2 before calling into this file.
+ */
+
+#include <c-stdaux.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "c-siphash.h"
+#include "c-siphash-private.h"
+
+#if C_SIPHASH_X86
+
+#include <emmintrin.h>
+
+#define C_SIPHASH_SSE2 __attribute__((__target__("sse2")))
+
+#define c_siphash_sse2_rotate_left(_x, _b) \
+        _mm_or_si128(_mm_slli_epi64((_x), (_b)), _mm_srli_epi64((_x), 64 - (_b)))
+
+static inline C_SIPHASH_SSE2 __m128i c_siphash_sse2_rotate_left16(__m128i x) {
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 1, 0, 3));
+        return _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 1, 0, 3));
+}
+
+static inline C_SIPHASH_SSE2 __m128i c_siphash_sse2_rotate_left32(__m128i x) {
+        return _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline C_SIPHASH_SSE2 void c_siphash_sse2_sipround(__m128i v[4]) {
+        v[0] = _mm_add_epi64(v[0], v[1]);
+        v[1] = c_siphash_sse2_rotate_left(v[1], 13);
+        v[1] = _mm_xor_si128(v[1], v[0]);
+        v[0] = c_siphash_sse2_rotate_left32(v[0]);
+        v[2] = _mm_add_epi64(v[2], v[3]);
+        v[3] = c_siphash_sse2_rotate_left16(v[3]);
+        v[3] = _mm_xor_si128(v[3], v[2]);
+        v[0] = _mm_add_epi64(v[0], v[3]);
+        v[3] = c_siphash_sse2_rotate_left(v[3], 21);
+        v[3] = _mm_xor_si128(v[3], v[0]);
+        v[2] = _mm_add_epi64(v[2], v[1]);
+        v[1] = c_siphash_sse2_rotate_left(v[1], 17);
+        v[1] = _mm_xor_si128(v[1], v[2]);
+        v[2] = c_siphash_sse2_rotate_left32(v[2]);
+}
+
+static inline C_SIPHASH_SSE2 void c_siphash_sse2_compress(__m128i v[4], __m128i m) {
+        v[3] = _mm_xor_si128(v[3], m);
+        c_siphash_sse2_sipround(v);
+        c_siphash_sse2_sipround(v);
+        v[0] = _mm_xor_si128(v[0], m);
+}
+
+static inline C_SIPHASH_SSE2 __m128i c_siphash_sse2_finalize(__m128i v[4]) {
+        v[2] = _mm_xor_si128(v[2], _mm_set_epi32(0, 0xff, 0, 0xff));
+
+        c_siphash_sse2_sipround(v);
+        c_siphash_sse2_sipround(v);
+        c_siphash_sse2_sipround(v);
+        c_siphash_sse2_sipround(v);
+
+        return _mm_xor_si128(_mm_xor_si128(v[0], v[1]),
+                             _mm_xor_si128(v[2], v[3]));
+}
+
+static inline C_SIPHASH_SSE2 __m128i c_siphash_sse2_select(__m128i mask, __m128i a, __m128i b) {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+C_SIPHASH_SSE2 void c_siphash_x2_sse2(const uint8_t seed[16],
+                                      const uint8_t *const bytes[2],
+                                      const size_t n_bytes[2],
+                                      uint64_t hashes[2]) {
+        size_t i, j, n_blocks[2], n_min, n_max;
+        uint64_t m[2], active[2];
+        __m128i v[4], w[4], mask;
+        CSipHash state;
+
+        c_siphash_init_inline(&state, seed);
+        v[0] = _mm_set1_epi64x(state.v0);
+        v[1] = _mm_set1_epi64x(state.v1);
+        v[2] = _mm_set1_epi64x(state.v2);
+        v[3] = _mm_set1_epi64x(state.v3);
+
+        n_blocks[0] = n_bytes[0] / 8 + 1;
+        n_blocks[1] = n_bytes[1] / 8 + 1;
+        n_min = c_min(n_blocks[0], n_blocks[1]);
+        n_max = c_max(n_blocks[0], n_blocks[1]);
+
+        /*
+         * As long as no message ran out of blocks, both lanes are busy and we
+         * can compress unconditionally. Up to the last block of the shorter
+         * message, all blocks are plain 64bit words.
+         */
+        for (i = 0; i + 1 < n_min; ++i) {
+                m[0] = c_siphash_read_le64(bytes[0] + i * 8);
+                m[1] = c_siphash_read_le64(bytes[1] + i * 8);
+
+                c_siphash_sse2_compress(v, _mm_loadu_si128((const __m128i *)m));
+        }
+
+        for ( ; i < n_min; ++i) {
+                m[0] = c_siphash_read_block(bytes[0], n_bytes[0], i);
+                m[1] = c_siphash_read_block(bytes[1], n_bytes[1], i);
+
+                c_siphash_sse2_compress(v, _mm_loadu_si128((const __m128i *)m));
+        }
+
+        /*
+         * The lane of the shorter message is done, but must not be touched
+         * until the other lane caught up. Compress both, but only keep the
+         * result of the active lane.
+         */
+        for ( ; i < n_max; ++i) {
+                for (j = 0; j < 2; ++j) {
+                        active[j] = (i < n_blocks[j]) ? UINT64_MAX : 0;
+                        m[j] = active[j] ? c_siphash_read_block(bytes[j], n_bytes[j], i) : 0;
+                }
+
+                mask = _mm_loadu_si128((const __m128i *)active);
+
+                w[0] = v[0];
+                w[1] = v[1];
+                w[2] = v[2];
+                w[3] = v[3];
+                c_siphash_sse2_compress(w, _mm_loadu_si128((const __m128i *)m));
+                v[0] = c_siphash_sse2_select(mask, w[0], v[0]);
+                v[1] = c_siphash_sse2_select(mask, w[1], v[1]);
+                v[2] = c_siphash_sse2_select(mask, w[2], v[2]);
+                v[3] = c_siphash_sse2_select(mask, w[3], v[3]);
+        }
+
+        _mm_storeu_si128((__m128i *)hashes, c_siphash_sse2_finalize(v));
+}
+
+#endif /* C_SIPHASH_X86 */
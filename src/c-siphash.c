@@ -6,46 +6,60 @@
  * SipHash, written by Jean-Philippe Aumasson and Daniel J. Bernstein, and
  * released to the Public Domain.
  *
- * So far, only SipHash24 is implemented, since there was no need for other
- * parameters. However, adjusted c_siphash_append_X() and
- * C_siphash_finalize_Y() can be easily provided, if required.
+ * The core API is implemented inline in c-siphash-core.h, and merely exported
+ * here. See C_SIPHASH_INLINE in the header for details.
+ *
+ * Both SipHash24 and SipHash-1-3 are implemented. Both are generated from
+ * the same rounds-parametrized core in the header, so other parameters can
+ * be easily provided, if required.
  */
 
 #include <c-stdaux.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include "c-siphash.h"
+#include "c-siphash-private.h"
 
-static inline uint64_t c_siphash_read_le64(const uint8_t bytes[8]) {
-        return  ((uint64_t) bytes[0]) |
-               (((uint64_t) bytes[1]) <<  8) |
-               (((uint64_t) bytes[2]) << 16) |
-               (((uint64_t) bytes[3]) << 24) |
-               (((uint64_t) bytes[4]) << 32) |
-               (((uint64_t) bytes[5]) << 40) |
-               (((uint64_t) bytes[6]) << 48) |
-               (((uint64_t) bytes[7]) << 56);
-}
+#if defined(__x86_64__) && defined(__SSE2__)
+#  include <emmintrin.h>
+#  define C_SIPHASH_COPY_STREAM 1
+#else
+#  define C_SIPHASH_COPY_STREAM 0
+#endif
+
+/*
+ * Copies of at least this size bypass the cache when storing to the
+ * destination, since they would evict most of it anyway.
+ */
+#define C_SIPHASH_COPY_STREAM_THRESHOLD (1024 * 1024)
 
-static inline uint64_t c_siphash_rotate_left(uint64_t x, uint8_t b) {
-        return (x << b) | (x >> (64 - b));
+/**
+ * c_siphash_key_init() - expand seed
+ * @key:                key object
+ * @seed:               128bit seed
+ *
+ * This expands @seed into the initial SipHash state, and stores it in @key.
+ * The key can then be used with c_siphash_init_key() and c_siphash_hash_key()
+ * any number of times, which avoids parsing the seed for every hash. A key
+ * object has no allocated resources and is never modified once initialized,
+ * so it can be shared freely between threads.
+ */
+_c_public_ void c_siphash_key_init(CSipHashKey *key, const uint8_t seed[16]) {
+        c_siphash_key_init_inline(key, seed);
 }
 
-static inline void c_siphash_sipround(CSipHash *state) {
-        state->v0 += state->v1;
-        state->v1 = c_siphash_rotate_left(state->v1, 13);
-        state->v1 ^= state->v0;
-        state->v0 = c_siphash_rotate_left(state->v0, 32);
-        state->v2 += state->v3;
-        state->v3 = c_siphash_rotate_left(state->v3, 16);
-        state->v3 ^= state->v2;
-        state->v0 += state->v3;
-        state->v3 = c_siphash_rotate_left(state->v3, 21);
-        state->v3 ^= state->v0;
-        state->v2 += state->v1;
-        state->v1 = c_siphash_rotate_left(state->v1, 17);
-        state->v1 ^= state->v2;
-        state->v2 = c_siphash_rotate_left(state->v2, 32);
+/**
+ * c_siphash_init_key() - initialize siphash context from key
+ * @state:              context object
+ * @key:                expanded seed
+ *
+ * This is equivalent to c_siphash_init(), but takes the seed in the form
+ * expanded by c_siphash_key_init().
+ */
+_c_public_ void c_siphash_init_key(CSipHash *state, const CSipHashKey *key) {
+        c_siphash_init_key_inline(state, key);
 }
 
 /**
@@ -62,30 +76,14 @@ static inline void c_siphash_sipround(CSipHash *state) {
  *
  * The hashes generated by this context change depending on the seed. Every
  * user is highly inclined to provide their unique seed. If no stable hashes
- * are needed, a random seed will do fine.
+ * are needed, a random seed will do fine. If the same seed is used for many
+ * hashes, consider expanding it once via c_siphash_key_init().
  *
- * Right now, only SipHash24 is supported. Other SipHash parameters can be
- * easily added if required.
+ * This initializes a SipHash24 context. See c_siphash13_init() for
+ * SipHash-1-3.
  */
 _c_public_ void c_siphash_init(CSipHash *state, const uint8_t seed[16]) {
-        uint64_t k0, k1;
-
-        k0 = c_siphash_read_le64(seed);
-        k1 = c_siphash_read_le64(seed + 8);
-
-        *state = (CSipHash) {
-                /*
-                 * Default seed is taken from the reference implementation
-                 * of SipHash24 ("somepseudorandomlygeneratedbytes"). Callers
-                 * are still recommended to provide proper seeds themselves.
-                 */
-                .v0 = 0x736f6d6570736575ULL ^ k0,
-                .v1 = 0x646f72616e646f6dULL ^ k1,
-                .v2 = 0x6c7967656e657261ULL ^ k0,
-                .v3 = 0x7465646279746573ULL ^ k1,
-                .padding = 0,
-                .n_bytes = 0,
-        };
+        c_siphash_init_inline(state, seed);
 }
 
 /**
@@ -105,78 +103,186 @@ _c_public_ void c_siphash_init(CSipHash *state, const uint8_t seed[16]) {
  * multiples of 64bit (8-bytes). This is not a requirement, though.
  */
 _c_public_ void c_siphash_append(CSipHash *state, const uint8_t *bytes, size_t n_bytes) {
-        const uint8_t *end = bytes + n_bytes;
-        size_t left = state->n_bytes & 7;
-        uint64_t m;
+        c_siphash_append_inline(state, bytes, n_bytes);
+}
+
+/**
+ * c_siphash_append_u8() - hash fixed-size integer
+ * @state:              context object
+ * @v:                  integer to hash
+ *
+ * This feeds the little-endian representation of @v into the SipHash state
+ * machine. The resulting hash is the same as if its bytes were passed to
+ * c_siphash_append(). However, @v is shifted into the pending bytes of
+ * @state, rather than merged byte by byte, and the resulting 64bit chunk is
+ * hashed once it is complete. The other typed helpers
+ * (c_siphash_append_u16(), c_siphash_append_u32(), c_siphash_append_u64(),
+ * c_siphash_append_bool()) work alike. Booleans are hashed as a single byte
+ * of value 0 or 1.
+ *
+ * With C_SIPHASH_INLINE, these are inlined into the caller, so no call is
+ * needed at all.
+ */
+_c_public_ void c_siphash_append_u8(CSipHash *state, uint8_t v) {
+        c_siphash_append_word(state, v, sizeof(v));
+}
 
-        state->n_bytes += n_bytes;
+_c_public_ void c_siphash_append_u16(CSipHash *state, uint16_t v) {
+        c_siphash_append_word(state, v, sizeof(v));
+}
 
-        /*
-         * SipHash operates on 64bit chunks. If the previous blob was not a
-         * multiple of 64bit in length, we must operate on single bytes.
-         */
-        if (left > 0) {
-                for ( ; bytes < end && left < 8; ++bytes, ++left)
-                        state->padding |= ((uint64_t) *bytes) << (left * 8);
+_c_public_ void c_siphash_append_u32(CSipHash *state, uint32_t v) {
+        c_siphash_append_word(state, v, sizeof(v));
+}
 
-                if (bytes == end && left < 8)
-                        return;
+_c_public_ void c_siphash_append_u64(CSipHash *state, uint64_t v) {
+        c_siphash_append_word(state, v, sizeof(v));
+}
 
-                state->v3 ^= state->padding;
-                c_siphash_sipround(state);
-                c_siphash_sipround(state);
-                state->v0 ^= state->padding;
+_c_public_ void c_siphash_append_bool(CSipHash *state, bool v) {
+        c_siphash_append_word(state, !!v, 1);
+}
 
-                state->padding = 0;
-        }
+/**
+ * c_siphash_append_str() - hash NUL-terminated string
+ * @state:              context object
+ * @str:                string to hash
+ * @n_bytesp:           output for the length of @str, or NULL
+ *
+ * This feeds the bytes of @str, excluding the terminating NUL, into the
+ * SipHash state machine. The result is identical to:
+ *
+ *         c_siphash_append(state, (const uint8_t *)str, strlen(str));
+ *
+ * If @n_bytesp is non-NULL, the length of the string is stored in it, so the
+ * caller does not have to call strlen() again.
+ */
+_c_public_ void c_siphash_append_str(CSipHash *state, const char *str, size_t *n_bytesp) {
+        size_t n_bytes = strlen(str);
 
-        end -= (state->n_bytes % sizeof(uint64_t));
+        c_siphash_append(state, (const uint8_t *)str, n_bytes);
+        if (n_bytesp)
+                *n_bytesp = n_bytes;
+}
 
-        /*
-         * We are now guaranteed to be at a 64bit state boundary. Hence, we can
-         * operate in 64bit chunks on all input. This is much faster than the
-         * one-byte-at-a-time loop.
-         */
-        for ( ; bytes < end; bytes += 8) {
-                m = c_siphash_read_le64(bytes);
+/*
+ * Lowercase the ASCII letters in each byte of @w, leaving all other bytes
+ * untouched. Adding 0x3f and 0x25 to the low 7 bits of a byte sets its high
+ * bit if it is at least 'A', or greater than 'Z', respectively. Neither can
+ * carry into the next byte. Non-ASCII bytes are excluded via their own high
+ * bit, and the resulting 0x80 flag is shifted to the case bit 0x20.
+ */
+static inline uint64_t c_siphash_casefold_word(uint64_t w) {
+        const uint64_t lows = UINT64_C(0x7f7f7f7f7f7f7f7f), highs = UINT64_C(0x8080808080808080);
+        uint64_t heptets, is_upper;
+
+        heptets = w & lows;
+        is_upper = (heptets + UINT64_C(0x3f3f3f3f3f3f3f3f)) &
+                   ~(heptets + UINT64_C(0x2525252525252525)) &
+                   ~w & highs;
+
+        return w | (is_upper >> 2);
+}
+
+static __attribute__((__flatten__)) void c_siphash_append_casefold(CSipHash *state, const uint8_t *bytes, size_t n_bytes) {
+        c_siphash_append_map(state, bytes, n_bytes, 2, c_siphash_casefold_word);
+}
+
+/**
+ * c_siphash_append_ascii_casefold() - hash data blob, ignoring ASCII case
+ * @state:              context object
+ * @bytes:              array of input bytes
+ * @n_bytes:            number of input bytes
+ *
+ * This feeds @bytes into the SipHash state machine, with all ASCII upper-case
+ * letters replaced by their lower-case equivalent. All other bytes, including
+ * non-ASCII ones, are hashed unchanged. The result is identical to calling
+ * c_siphash_append() on a lower-cased copy of @bytes, but there is no copy,
+ * and no separate pass. Instead, the word loop of c_siphash_append() folds
+ * each word, with a handful of bit operations.
+ *
+ * This is meant for case-insensitive lookups of protocol identifiers, like
+ * HTTP header names or DNS labels.
+ */
+_c_public_ void c_siphash_append_ascii_casefold(CSipHash *state, const uint8_t *bytes, size_t n_bytes) {
+        CSipHash s = *state;
 
-                state->v3 ^= m;
-                c_siphash_sipround(state);
-                c_siphash_sipround(state);
-                state->v0 ^= m;
+        /* work on a copy, which the input cannot alias, to keep it in registers */
+        c_siphash_append_casefold(&s, bytes, n_bytes);
+        *state = s;
+}
+
+/*
+ * Copies are split into blocks of this size. Each block is copied, and then
+ * hashed while the source is still in the L1 cache.
+ */
+#define C_SIPHASH_COPY_BLOCK (4096)
+
+static inline void c_siphash_copy_block(uint8_t *dst, const uint8_t *src, size_t n_bytes, bool stream) {
+#if C_SIPHASH_COPY_STREAM
+        uint64_t m;
+
+        if (stream) {
+                for ( ; n_bytes >= 8; src += 8, dst += 8, n_bytes -= 8) {
+                        m = c_siphash_read_le64(src);
+                        _mm_stream_si64((long long *)dst, (long long)m);
+                }
         }
+#else
+        (void)stream;
+#endif
 
-        /*
-         * Now that we hashed as much 64bit chunks as possible, we need to
-         * remember the remaining trailing bytes. Keep them in @padding so the
-         * next round (or the finalizer) get access to them.
-         */
-        left = state->n_bytes & 7;
-        switch (left) {
-                case 7:
-                        state->padding |= ((uint64_t) bytes[6]) << 48;
-                        /* fallthrough */
-                case 6:
-                        state->padding |= ((uint64_t) bytes[5]) << 40;
-                        /* fallthrough */
-                case 5:
-                        state->padding |= ((uint64_t) bytes[4]) << 32;
-                        /* fallthrough */
-                case 4:
-                        state->padding |= ((uint64_t) bytes[3]) << 24;
-                        /* fallthrough */
-                case 3:
-                        state->padding |= ((uint64_t) bytes[2]) << 16;
-                        /* fallthrough */
-                case 2:
-                        state->padding |= ((uint64_t) bytes[1]) <<  8;
-                        /* fallthrough */
-                case 1:
-                        state->padding |= ((uint64_t) bytes[0]);
-                        /* fallthrough */
-                case 0:
-                        break;
+        if (n_bytes)
+                memcpy(dst, src, n_bytes);
+}
+
+static inline void c_siphash_append_copy_inline(CSipHash *state,
+                                                uint8_t *dst,
+                                                const uint8_t *src,
+                                                size_t n_bytes) {
+        bool stream = false;
+        size_t n;
+
+#if C_SIPHASH_COPY_STREAM
+        stream = n_bytes >= C_SIPHASH_COPY_STREAM_THRESHOLD && !((uintptr_t)dst & 7);
+#endif
+
+        for ( ; n_bytes > 0; src += n, dst += n, n_bytes -= n) {
+                n = c_min(n_bytes, (size_t)C_SIPHASH_COPY_BLOCK);
+                c_siphash_copy_block(dst, src, n, stream);
+                c_siphash_append_inline(state, src, n);
         }
+
+#if C_SIPHASH_COPY_STREAM
+        /* order the streaming stores before any later store */
+        if (stream)
+                _mm_sfence();
+#endif
+}
+
+/**
+ * c_siphash_append_copy() - hash stream of data, while copying it
+ * @state:              context object
+ * @dst:                destination buffer of @n_bytes bytes
+ * @src:                array of input bytes
+ * @n_bytes:            number of input bytes
+ *
+ * This copies @n_bytes bytes from @src to @dst, like memcpy() does, and feeds
+ * them into the SipHash state machine, like c_siphash_append() does. The
+ * buffers must not overlap. The input is copied in blocks of 4KiB, and each
+ * block is hashed right after it was copied, while it is still cached. Hence,
+ * the input is only read from memory once.
+ *
+ * Copies of at least 1MiB use non-temporal stores on x86-64, which bypass the
+ * cache. Such copies would evict most of the cache anyway, and it avoids
+ * reading the destination into the cache before overwriting it.
+ */
+_c_public_ void c_siphash_append_copy(CSipHash *state, uint8_t *dst, const uint8_t *src, size_t n_bytes) {
+        CSipHash s = *state;
+
+        /* work on a copy, which the buffers cannot alias, to keep it in registers */
+        c_siphash_append_copy_inline(&s, dst, src, n_bytes);
+        *state = s;
 }
 
 /**
@@ -195,51 +301,638 @@ _c_public_ void c_siphash_append(CSipHash *state, const uint8_t *bytes, size_t n
  * Return: 64bit hash value
  */
 _c_public_ uint64_t c_siphash_finalize(CSipHash *state) {
+        return c_siphash_finalize_inline(state);
+}
+
+/**
+ * c_siphash_hash() - hash data blob
+ * @seed:               128bit seed
+ * @bytes:              byte array to hash
+ * @n_bytes:            number of bytes to hash
+ *
+ * This produces the SipHash24 hash value for the input @bytes / @n_bytes,
+ * using the seed provided as @seed.
+ *
+ * This is functionally equivalent to:
+ *
+ *         CSipHash state;
+ *         c_siphash_init(&state, seed);
+ *         c_siphash_append(&state, bytes, n_bytes);
+ *         return c_siphash_finalize(&state);
+ *
+ * Unlike the streaming API, this is a one-shot call suitable for any data that
+ * is available in-memory at the same time.
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash_hash(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes) {
+        return c_siphash_hash_inline(seed, bytes, n_bytes);
+}
+
+/**
+ * c_siphash_hash_str() - hash NUL-terminated string
+ * @seed:               128bit seed
+ * @str:                string to hash
+ * @n_bytesp:           output for the length of @str, or NULL
+ *
+ * This is the one-shot equivalent of c_siphash_append_str(). It produces the
+ * same hash value as:
+ *
+ *         c_siphash_hash(seed, (const uint8_t *)str, strlen(str));
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash_hash_str(const uint8_t seed[16], const char *str, size_t *n_bytesp) {
+        size_t n_bytes = strlen(str);
+
+        if (n_bytesp)
+                *n_bytesp = n_bytes;
+
+        return c_siphash_hash_inline(seed, (const uint8_t *)str, n_bytes);
+}
+
+/**
+ * c_siphash_hash_ascii_casefold() - hash data blob, ignoring ASCII case
+ * @seed:               128bit seed
+ * @bytes:              byte array to hash
+ * @n_bytes:            number of bytes to hash
+ *
+ * This is the one-shot equivalent of c_siphash_append_ascii_casefold().
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash_hash_ascii_casefold(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes) {
+        CSipHash state;
+
+        c_siphash_init_inline(&state, seed);
+        c_siphash_append_casefold(&state, bytes, n_bytes);
+
+        return c_siphash_finalize_inline(&state);
+}
+
+/**
+ * c_siphash_hash_prefixes() - hash every delimited prefix of data blob
+ * @seed:               128bit seed
+ * @bytes:              byte array to hash
+ * @n_bytes:            number of bytes to hash
+ * @delim:              delimiter byte
+ * @hashes:             output array for up to @n_hashes 64bit hash values
+ * @n_hashes:           size of @hashes
+ *
+ * This produces the SipHash24 hash values of all prefixes of @bytes that end
+ * right before an occurrence of @delim, followed by the hash value of all of
+ * @bytes. Empty prefixes are skipped. For the path "/a/b" and delimiter '/',
+ * these are the hash values of "/a" and "/a/b". Each hash value is identical
+ * to calling c_siphash_hash() on the prefix.
+ *
+ * The input is streamed through a single SipHash state, and each hash value is
+ * produced by finalizing a copy of it. Hence, the cost is linear in @n_bytes,
+ * rather than in the sum of the lengths of all prefixes.
+ *
+ * At most @n_hashes values are stored in @hashes, in order of increasing
+ * length. Once @hashes is full, the remaining input is only scanned for
+ * delimiters, but not hashed.
+ *
+ * Return: Number of prefixes, which can exceed @n_hashes.
+ */
+_c_public_ size_t c_siphash_hash_prefixes(const uint8_t seed[16],
+                                          const uint8_t *bytes,
+                                          size_t n_bytes,
+                                          uint8_t delim,
+                                          uint64_t *hashes,
+                                          size_t n_hashes) {
+        const uint8_t *end = bytes + n_bytes, *hashed = bytes, *p = bytes, *next;
+        CSipHash state, copy;
+        size_t n = 0;
+
+        c_siphash_init_inline(&state, seed);
+
+        for (;;) {
+                next = (p < end) ? memchr(p, delim, end - p) : NULL;
+                if (!next)
+                        next = end;
+
+                if (next > bytes) {
+                        if (n < n_hashes) {
+                                c_siphash_append_inline(&state, hashed, next - hashed);
+                                hashed = next;
+
+                                copy = state;
+                                hashes[n] = c_siphash_finalize_inline(&copy);
+                        }
+                        ++n;
+                }
+
+                if (next == end)
+                        break;
+
+                p = next + 1;
+        }
+
+        return n;
+}
+
+/**
+ * c_siphash_prefix_init() - hash common prefix
+ * @prefix:             prefix object to initialize
+ * @seed:               128bit seed
+ * @bytes:              byte array of the prefix
+ * @n_bytes:            number of bytes of the prefix
+ *
+ * This hashes the prefix @bytes / @n_bytes with the seed provided as @seed,
+ * and stores the resulting state in @prefix. See c_siphash_hash_from() for
+ * how to use it.
+ */
+_c_public_ void c_siphash_prefix_init(CSipHashPrefix *prefix,
+                                      const uint8_t seed[16],
+                                      const uint8_t *bytes,
+                                      size_t n_bytes) {
+        CSipHash state;
+
+        c_siphash_init_inline(&state, seed);
+        c_siphash_append_inline(&state, bytes, n_bytes);
+        prefix->state = state;
+}
+
+/**
+ * c_siphash_hash_from() - hash data blob after common prefix
+ * @prefix:             prefix object
+ * @bytes:              byte array to hash
+ * @n_bytes:            number of bytes to hash
+ *
+ * This produces the SipHash24 hash value of the prefix hashed into @prefix by
+ * c_siphash_prefix_init(), followed by @bytes / @n_bytes. The result is
+ * identical to calling c_siphash_hash() on the concatenation of both. This
+ * suits keys with a long common namespace, like a tenant or table name, since
+ * the cost only depends on @n_bytes.
+ *
+ * The prefix does not have to be a multiple of 8 bytes in length. If it is
+ * not, the words of @bytes are shifted into place, rather than completing the
+ * pending word of the prefix byte by byte.
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ __attribute__((__flatten__)) uint64_t c_siphash_hash_from(const CSipHashPrefix *prefix, const uint8_t *bytes, size_t n_bytes) {
+        CSipHash state = prefix->state;
+
+        c_siphash_append_inline(&state, bytes, n_bytes);
+
+        return c_siphash_finalize_inline(&state);
+}
+
+/**
+ * c_siphash_hash_key() - hash data blob with expanded seed
+ * @key:                expanded seed
+ * @bytes:              byte array to hash
+ * @n_bytes:            number of bytes to hash
+ *
+ * This is equivalent to c_siphash_hash(), but takes the seed in the form
+ * expanded by c_siphash_key_init().
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash_hash_key(const CSipHashKey *key, const uint8_t *bytes, size_t n_bytes) {
+        return c_siphash_hash_key_inline(key, bytes, n_bytes);
+}
+
+/*
+ * Hash a message of @n_words 64bit words, followed by the trailing bytes in
+ * @tail, for a total length of @n_bytes. The callers pass constants for all
+ * but the data, so the compiler unrolls this into a straight sequence of
+ * compressions without any of the length handling of c_siphash_append().
+ */
+static inline uint64_t c_siphash_hash_fixed(const uint8_t seed[16],
+                                            const uint8_t *bytes,
+                                            size_t n_words,
+                                            uint64_t tail,
+                                            size_t n_bytes) {
+        CSipHash state;
+        size_t i;
+
+        c_siphash_init_inline(&state, seed);
+
+        for (i = 0; i < n_words; ++i)
+                c_siphash_compress(&state, c_siphash_read_le64(bytes + i * 8));
+
+        state.padding = tail;
+        state.n_bytes = n_bytes;
+        return c_siphash_finalize_inline(&state);
+}
+
+/**
+ * c_siphash_hash_u32() - hash 32bit integer
+ * @seed:               128bit seed
+ * @v:                  integer to hash
+ *
+ * This produces the SipHash24 hash value of the little-endian representation
+ * of @v, using the seed provided as @seed. The result is identical to passing
+ * those 4 bytes to c_siphash_hash(), but the fixed length allows for a fully
+ * unrolled implementation without any branches.
+ *
+ * The other fixed-size helpers (c_siphash_hash_u64(), c_siphash_hash_16(),
+ * c_siphash_hash_32()) work alike, for 64bit integers and for 16 and 32 byte
+ * arrays, respectively.
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash_hash_u32(const uint8_t seed[16], uint32_t v) {
+        return c_siphash_hash_fixed(seed, NULL, 0, v, sizeof(v));
+}
+
+/**
+ * c_siphash_hash_u64() - hash 64bit integer
+ * @seed:               128bit seed
+ * @v:                  integer to hash
+ *
+ * See c_siphash_hash_u32() for details.
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash_hash_u64(const uint8_t seed[16], uint64_t v) {
+        const uint8_t bytes[] = {
+                v, v >> 8, v >> 16, v >> 24, v >> 32, v >> 40, v >> 48, v >> 56,
+        };
+
+        /* compilers merge the little-endian store and the load back into @v */
+        return c_siphash_hash_fixed(seed, bytes, 1, 0, sizeof(v));
+}
+
+/**
+ * c_siphash_hash_16() - hash 16 byte array
+ * @seed:               128bit seed
+ * @bytes:              byte array to hash
+ *
+ * See c_siphash_hash_u32() for details.
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash_hash_16(const uint8_t seed[16], const uint8_t bytes[16]) {
+        return c_siphash_hash_fixed(seed, bytes, 2, 0, 16);
+}
+
+/**
+ * c_siphash_hash_32() - hash 32 byte array
+ * @seed:               128bit seed
+ * @bytes:              byte array to hash
+ *
+ * See c_siphash_hash_u32() for details.
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash_hash_32(const uint8_t seed[16], const uint8_t bytes[32]) {
+        return c_siphash_hash_fixed(seed, bytes, 4, 0, 32);
+}
+
+/**
+ * c_siphash_init128() - initialize siphash context for 128bit output
+ * @state:              context object
+ * @seed:               128bit seed
+ *
+ * This initializes @state like c_siphash_init() does, but prepares it for the
+ * 128bit output mode of SipHash24. Such a state is fed via c_siphash_append()
+ * like any other, but must be finalized via c_siphash_finalize128(). The
+ * 128bit mode differs from the 64bit mode right from the initial state, so
+ * the output mode cannot be changed once hashing started.
+ */
+_c_public_ void c_siphash_init128(CSipHash *state, const uint8_t seed[16]) {
+        c_siphash_init_inline(state, seed);
+        state->v1 ^= 0xee;
+}
+
+/**
+ * c_siphash_finalize128() - finalize 128bit hash
+ * @state:              context object
+ * @hash:               output array for the 128bit hash value
+ *
+ * This produces the final 128bit SipHash24 hash value for the given state,
+ * which must have been initialized via c_siphash_init128(). The hash is
+ * returned as two 64bit words, @hash[0] being the first. Their little-endian
+ * representations, concatenated, match the byte output of the reference
+ * implementation.
+ *
+ * Both words are computed from a single pass over the input, so this is much
+ * cheaper than computing two 64bit hashes with different seeds. Like with
+ * c_siphash_finalize(), @state is invalid after this function returns.
+ */
+_c_public_ void c_siphash_finalize128(CSipHash *state, uint64_t hash[2]) {
         uint64_t b;
 
         b = state->padding | (((uint64_t) state->n_bytes) << 56);
 
-        state->v3 ^= b;
+        c_siphash_compress(state, b);
+
+        state->v2 ^= 0xee;
+
+        c_siphash_sipround(state);
+        c_siphash_sipround(state);
         c_siphash_sipround(state);
         c_siphash_sipround(state);
-        state->v0 ^= b;
 
-        state->v2 ^= 0xff;
+        hash[0] = state->v0 ^ state->v1 ^ state->v2 ^ state->v3;
+
+        state->v1 ^= 0xdd;
 
         c_siphash_sipround(state);
         c_siphash_sipround(state);
         c_siphash_sipround(state);
         c_siphash_sipround(state);
 
-        return state->v0 ^ state->v1 ^ state->v2  ^ state->v3;
+        hash[1] = state->v0 ^ state->v1 ^ state->v2 ^ state->v3;
 }
 
 /**
- * c_siphash_hash() - hash data blob
+ * c_siphash_hash128() - hash data blob with 128bit output
  * @seed:               128bit seed
  * @bytes:              byte array to hash
  * @n_bytes:            number of bytes to hash
+ * @hash:               output array for the 128bit hash value
  *
- * This produces the SipHash24 hash value for the input @bytes / @n_bytes,
- * using the seed provided as @seed.
+ * This produces the 128bit SipHash24 hash value for the input @bytes /
+ * @n_bytes, using the seed provided as @seed. It is the 128bit equivalent of
+ * c_siphash_hash(). See c_siphash_finalize128() for the output format.
+ */
+_c_public_ void c_siphash_hash128(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes, uint64_t hash[2]) {
+        CSipHash state;
+
+        c_siphash_init128(&state, seed);
+        c_siphash_append_inline(&state, bytes, n_bytes);
+        c_siphash_finalize128(&state, hash);
+}
+
+/**
+ * c_siphash13_init() - initialize SipHash-1-3 context
+ * @state:              context object
+ * @seed:               128bit seed
  *
- * This is functionally equivalent to:
+ * This is the SipHash-1-3 equivalent of c_siphash_init(). Seeds are
+ * interpreted the same way for all SipHash variants.
+ */
+_c_public_ void c_siphash13_init(CSipHash13 *state, const uint8_t seed[16]) {
+        c_siphash_init_inline(&state->state, seed);
+}
+
+/**
+ * c_siphash13_append() - hash stream of data with SipHash-1-3
+ * @state:              context object
+ * @bytes:              array of input bytes
+ * @n_bytes:            number of input bytes
  *
- *         CSipHash state;
- *         c_siphash_init(&state, seed);
- *         c_siphash_append(&state, bytes, n_bytes);
- *         return c_siphash_finalize(&state);
+ * This is the SipHash-1-3 equivalent of c_siphash_append().
+ */
+_c_public_ void c_siphash13_append(CSipHash13 *state, const uint8_t *bytes, size_t n_bytes) {
+        c_siphash_append_rounds(&state->state, bytes, n_bytes, 1);
+}
+
+/**
+ * c_siphash13_finalize() - finalize SipHash-1-3 hash
+ * @state:              context object
  *
- * Unlike the streaming API, this is a one-shot call suitable for any data that
- * is available in-memory at the same time.
+ * This is the SipHash-1-3 equivalent of c_siphash_finalize().
  *
  * Return: 64bit hash value
  */
-_c_public_ uint64_t c_siphash_hash(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes) {
-        CSipHash state;
+_c_public_ uint64_t c_siphash13_finalize(CSipHash13 *state) {
+        return c_siphash_finalize_rounds(&state->state, 1, 3);
+}
+
+/**
+ * c_siphash13_hash() - hash data blob with SipHash-1-3
+ * @seed:               128bit seed
+ * @bytes:              byte array to hash
+ * @n_bytes:            number of bytes to hash
+ *
+ * This is the SipHash-1-3 equivalent of c_siphash_hash().
+ *
+ * Return: 64bit hash value
+ */
+_c_public_ uint64_t c_siphash13_hash(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes) {
+        CSipHash13 state;
+
+        c_siphash13_init(&state, seed);
+        c_siphash13_append(&state, bytes, n_bytes);
 
-        c_siphash_init(&state, seed);
-        c_siphash_append(&state, bytes, n_bytes);
+        return c_siphash13_finalize(&state);
+}
+
+/**
+ * c_siphash_hash_x4() - hash four data blobs
+ * @seed:               128bit seed
+ * @bytes:              array of four byte arrays to hash
+ * @n_bytes:            array of the number of bytes to hash, for each blob
+ * @hashes:             output array for the four 64bit hash values
+ *
+ * This produces the SipHash24 hash values of four independent data blobs,
+ * using the seed provided as @seed for all of them. The blobs do not have to
+ * be of equal length. The result is identical to calling c_siphash_hash() on
+ * each of them:
+ *
+ *         for (i = 0; i < 4; ++i)
+ *                 hashes[i] = c_siphash_hash(seed, bytes[i], n_bytes[i]);
+ *
+ * On CPUs with AVX2 support, the four blobs are hashed in parallel, using one
+ * SIMD lane per blob. This considerably increases the throughput for short
+ * blobs, compared to hashing them one after another. See
+ * c_siphash_get_implementation() for the kernels selected at runtime.
+ */
+_c_public_ void c_siphash_hash_x4(const uint8_t seed[16],
+                                  const uint8_t *const bytes[4],
+                                  const size_t n_bytes[4],
+                                  uint64_t hashes[4]) {
+        c_siphash_impl_get()->hash_x4(seed, bytes, n_bytes, hashes);
+}
+
+/**
+ * c_siphash_hash_x8() - hash eight data blobs
+ * @seed:               128bit seed
+ * @bytes:              array of eight byte arrays to hash
+ * @n_bytes:            array of the number of bytes to hash, for each blob
+ * @hashes:             output array for the eight 64bit hash values
+ *
+ * This is the eight-lane equivalent of c_siphash_hash_x4(). It produces the
+ * SipHash24 hash values of eight independent data blobs of arbitrary lengths,
+ * using the seed provided as @seed for all of them.
+ *
+ * On CPUs with AVX-512F support, all eight blobs are hashed in parallel.
+ * Otherwise, this hashes them as two groups of four.
+ */
+_c_public_ void c_siphash_hash_x8(const uint8_t seed[16],
+                                  const uint8_t *const bytes[8],
+                                  const size_t n_bytes[8],
+                                  uint64_t hashes[8]) {
+        c_siphash_impl_get()->hash_x8(seed, bytes, n_bytes, hashes);
+}
+
+/*
+ * Hash @n blobs in groups, using the widest kernel of @impl that is tuned for
+ * the lengths in each group. Lanes of a group run until its longest blob is
+ * done, so this works best if blobs of similar lengths are adjacent.
+ */
+static void c_siphash_hash_groups(const CSipHashImpl *impl,
+                                  const uint8_t seed[16],
+                                  const uint8_t *const *bytes,
+                                  const size_t *n_bytes,
+                                  size_t n,
+                                  uint64_t *hashes) {
+        size_t i, j, n_max, lanes;
+
+        for (i = 0; i < n; ) {
+                /*
+                 * Pick the number of lanes for the next group, depending on
+                 * the longest message it would contain. By default, this is
+                 * the widest kernel. See c_siphash_calibrate() for details.
+                 */
+                n_max = 0;
+                for (j = i; j < n && j < i + impl->n_lanes; ++j)
+                        n_max = c_max(n_max, n_bytes[j]);
 
-        return c_siphash_finalize(&state);
+                lanes = c_siphash_impl_lanes(impl, n_max);
+
+                if (lanes >= 8 && i + 8 <= n) {
+                        impl->hash_x8(seed, bytes + i, n_bytes + i, hashes + i);
+                        i += 8;
+                } else if (lanes >= 4 && i + 4 <= n) {
+                        impl->hash_x4(seed, bytes + i, n_bytes + i, hashes + i);
+                        i += 4;
+                } else if (lanes >= 2 && i + 2 <= n) {
+                        impl->hash_x2(seed, bytes + i, n_bytes + i, hashes + i);
+                        i += 2;
+                } else {
+                        hashes[i] = c_siphash_hash_inline(seed, bytes[i], n_bytes[i]);
+                        ++i;
+                }
+        }
+}
+
+/*
+ * Hash a chunk of at most C_SIPHASH_BATCH_CHUNK blobs, bucketed by length.
+ * See c_siphash_hash_batch() for details.
+ */
+void c_siphash_hash_chunk(const CSipHashImpl *impl,
+                          const uint8_t seed[16],
+                          const uint8_t *const *bytes,
+                          const size_t *n_bytes,
+                          size_t n,
+                          uint64_t *hashes) {
+        const uint8_t *sorted_bytes[C_SIPHASH_BATCH_CHUNK];
+        size_t sorted_n_bytes[C_SIPHASH_BATCH_CHUNK];
+        uint64_t sorted_hashes[C_SIPHASH_BATCH_CHUNK];
+        uint16_t order[C_SIPHASH_BATCH_CHUNK];
+        uint8_t classes[C_SIPHASH_BATCH_CHUNK];
+        size_t offsets[C_SIPHASH_N_LENGTH_CLASSES];
+        size_t j, c, n_classes;
+
+        c_assert(n <= C_SIPHASH_BATCH_CHUNK);
+
+        /* without multi-lane kernels, there is nothing to gain */
+        if (impl->n_lanes < 2) {
+                c_siphash_hash_groups(impl, seed, bytes, n_bytes, n, hashes);
+                return;
+        }
+
+        memset(offsets, 0, sizeof(offsets));
+        for (j = 0; j < n; ++j) {
+                classes[j] = c_siphash_length_class(n_bytes[j]);
+                ++offsets[classes[j]];
+        }
+
+        /*
+         * If all blobs of the chunk fall into the same class, they can be
+         * grouped as they are.
+         */
+        n_classes = 0;
+        for (c = 0; c < C_SIPHASH_N_LENGTH_CLASSES; ++c)
+                n_classes += !!offsets[c];
+
+        if (n_classes < 2) {
+                c_siphash_hash_groups(impl, seed, bytes, n_bytes, n, hashes);
+                return;
+        }
+
+        /* counting sort of the chunk by length class */
+        for (j = 0, c = 0; c < C_SIPHASH_N_LENGTH_CLASSES; ++c) {
+                j += offsets[c];
+                offsets[c] = j - offsets[c];
+        }
+
+        for (j = 0; j < n; ++j)
+                order[offsets[classes[j]]++] = j;
+
+        for (j = 0; j < n; ++j) {
+                sorted_bytes[j] = bytes[order[j]];
+                sorted_n_bytes[j] = n_bytes[order[j]];
+        }
+
+        c_siphash_hash_groups(impl, seed, sorted_bytes, sorted_n_bytes, n, sorted_hashes);
+
+        for (j = 0; j < n; ++j)
+                hashes[order[j]] = sorted_hashes[j];
+}
+
+/**
+ * c_siphash_hash_batch() - hash array of data blobs
+ * @seed:               128bit seed
+ * @bytes:              array of @n byte arrays to hash
+ * @n_bytes:            array of the number of bytes to hash, for each blob
+ * @n:                  number of blobs
+ * @hashes:             output array for the @n 64bit hash values
+ *
+ * This produces the SipHash24 hash values of @n independent data blobs, using
+ * the seed provided as @seed for all of them. The result is identical to
+ * calling c_siphash_hash() on each blob:
+ *
+ *         for (i = 0; i < n; ++i)
+ *                 hashes[i] = c_siphash_hash(seed, bytes[i], n_bytes[i]);
+ *
+ * Blobs are hashed in groups, using the widest multi-lane kernel selected for
+ * the CPU at runtime. On x86-64, at least the two-lane SSE2 kernel is always
+ * available. Only the remainder that does not fill a group is hashed one by
+ * one. If c_siphash_calibrate() was called, the number of lanes is instead
+ * picked based on the message lengths in each group.
+ *
+ * A group takes as long as its longest blob. Hence, blobs are bucketed by
+ * length before they are grouped, so short blobs do not wait for long ones.
+ * The hash values are still stored in the order of the input. Bucketing is
+ * done in chunks of a fixed number of blobs on the stack, so this never
+ * allocates memory.
+ */
+_c_public_ void c_siphash_hash_batch(const uint8_t seed[16],
+                                     const uint8_t *const *bytes,
+                                     const size_t *n_bytes,
+                                     size_t n,
+                                     uint64_t *hashes) {
+        const CSipHashImpl *impl = c_siphash_impl_get();
+        size_t i, n_chunk;
+
+        for (i = 0; i < n; i += n_chunk) {
+                n_chunk = c_min(n - i, (size_t)C_SIPHASH_BATCH_CHUNK);
+                c_siphash_hash_chunk(impl, seed, bytes + i, n_bytes + i, n_chunk, hashes + i);
+        }
+}
+
+/**
+ * c_siphash_hash_multikey() - hash data blob with multiple keys
+ * @keys:               array of @n_keys expanded seeds
+ * @n_keys:             number of keys
+ * @bytes:              byte array to hash
+ * @n_bytes:            number of bytes to hash
+ * @hashes:             output array for the @n_keys 64bit hash values
+ *
+ * This produces @n_keys independent SipHash24 hash values of the same input
+ * @bytes / @n_bytes, one with each key in @keys. This is what Bloom filters
+ * and sketches need. The result is identical to calling c_siphash_hash_key()
+ * with each key:
+ *
+ *         for (i = 0; i < n_keys; ++i)
+ *                 hashes[i] = c_siphash_hash_key(&keys[i], bytes, n_bytes);
+ *
+ * On CPUs with AVX2 or AVX-512F support, the keys are assigned to SIMD lanes,
+ * and each word of the input is read once and fed to all of them. Hence,
+ * four or eight hash values cost little more than a single one.
+ */
+_c_public_ void c_siphash_hash_multikey(const CSipHashKey *keys,
+                                        size_t n_keys,
+                                        const uint8_t *bytes,
+                                        size_t n_bytes,
+                                        uint64_t *hashes) {
+        c_siphash_impl_get()->hash_multikey(keys, n_keys, bytes, n_bytes, hashes);
 }
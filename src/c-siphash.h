@@ -3,10 +3,16 @@
 /**
  * Streaming-capable SipHash Implementation
  *
- * This library provides a SipHash API, that is fully implemented in ISO-C11
- * and has no external dependencies. The library performs no memory allocation,
- * and provides a streaming API where data to be hashed can be appended
- * piecemeal.
+ * This library provides a SipHash API, written in C11 with GNU extensions. The
+ * header is C11 as well, except for the empty initializers of the *_NULL
+ * macros, which are a GNU extension. The library performs no memory
+ * allocation, and provides a streaming API where data to be hashed can be
+ * appended piecemeal.
+ *
+ * The implementation requires a GCC-compatible compiler. It uses GNU
+ * attributes (flatten, target and constructor), as well as compiler builtins
+ * like __builtin_cpu_supports(). On x86-64, the multi-lane kernels use SSE2,
+ * AVX2 and AVX-512 intrinsics, selected at load time.
  *
  * A streaming-capable hash state is represented by the "CSipHash" structure,
  * which should be initialized with a unique seed before use. If streaming
@@ -18,10 +24,16 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 typedef struct CSipHash CSipHash;
+typedef struct CSipHashKey CSipHashKey;
+typedef struct CSipHash13 CSipHash13;
+typedef struct CSipHashHalf CSipHashHalf;
+typedef struct CSipHashColumn CSipHashColumn;
+typedef struct CSipHashPrefix CSipHashPrefix;
 
 /**
  * struct CSipHash - SipHash state object
@@ -49,12 +61,274 @@ struct CSipHash {
 
 #define C_SIPHASH_NULL {}
 
+/**
+ * struct CSipHashKey - expanded SipHash seed
+ * @v0-@v3:             initial state
+ *
+ * A CSipHashKey object holds the initial SipHash state derived from a seed.
+ * It is initialized once via c_siphash_key_init(), and can then be used to
+ * initialize any number of CSipHash objects, without parsing the seed again.
+ *
+ * This key object has no allocated resources. It is safe to release its
+ * backing memory without any further action.
+ */
+struct CSipHashKey {
+        uint64_t v0;
+        uint64_t v1;
+        uint64_t v2;
+        uint64_t v3;
+};
+
+#define C_SIPHASH_KEY_NULL {}
+
+/**
+ * struct CSipHash13 - SipHash-1-3 state object
+ * @state:              internal state
+ *
+ * This is the equivalent of CSipHash for SipHash-1-3, which uses a single
+ * SipRound per compression, and three for finalization. It is considerably
+ * faster than SipHash24, and the common trade-off for hash tables. It uses
+ * its own type, so it cannot be mixed up with SipHash24 states.
+ *
+ * The internal state is laid out like CSipHash, and is initialized, fed and
+ * finalized via c_siphash13_init(), c_siphash13_append(), and
+ * c_siphash13_finalize(), respectively.
+ */
+struct CSipHash13 {
+        CSipHash state;
+};
+
+#define C_SIPHASH13_NULL {}
+
+/**
+ * struct CSipHashHalf - HalfSipHash state object
+ * @v0-@v3:             internal state
+ * @padding:            pending bytes that were not a multiple of 4
+ * @n_bytes:            number of hashed bytes
+ *
+ * This is the equivalent of CSipHash for HalfSipHash-2-4, which operates on
+ * 32bit words, takes a 64bit seed, and produces 32bit or 64bit hashes. It is
+ * meant for hash tables that only need 32bit hashes, and for 32bit CPUs, where
+ * it is considerably faster than SipHash24. Its security margin is lower, so
+ * it should not be used where 64bit hashes are exposed.
+ *
+ * The state is initialized via c_siphash_half_init() or
+ * c_siphash_half_init64(), fed via c_siphash_half_append(), and finalized via
+ * c_siphash_half_finalize() or c_siphash_half_finalize64(), respectively.
+ */
+struct CSipHashHalf {
+        uint32_t v0;
+        uint32_t v1;
+        uint32_t v2;
+        uint32_t v3;
+        uint32_t padding;
+        size_t n_bytes;
+};
+
+#define C_SIPHASH_HALF_NULL {}
+
+/**
+ * struct CSipHashColumn - column descriptor
+ * @data:               data buffer of the column
+ * @offsets:            offsets of variable-length fields, or NULL
+ * @width:              size of fixed-width fields, in bytes
+ *
+ * A CSipHashColumn object describes a column of fields for
+ * c_siphash_hash_rows(). If @offsets is NULL, the column stores fields of
+ * @width bytes back to back in @data. Otherwise, @width is ignored, and field
+ * i is stored in @data from offset @offsets[i] up to @offsets[i + 1].
+ */
+struct CSipHashColumn {
+        const uint8_t *data;
+        const uint32_t *offsets;
+        size_t width;
+};
+
+/**
+ * struct CSipHashPrefix - SipHash state of a common prefix
+ * @state:              internal state
+ *
+ * A CSipHashPrefix object holds the SipHash24 state after a prefix has been
+ * hashed. It is initialized once via c_siphash_prefix_init(), and can then be
+ * used to hash any number of messages that start with this prefix, via
+ * c_siphash_hash_from(), without hashing the prefix again. It is never
+ * modified afterwards, so it can be shared between threads.
+ *
+ * This object has no allocated resources. It is safe to release its backing
+ * memory without any further action.
+ */
+struct CSipHashPrefix {
+        CSipHash state;
+};
+
+#define C_SIPHASH_PREFIX_NULL {}
+
+#if !defined(C_SIPHASH_INLINE)
+void c_siphash_key_init(CSipHashKey *key, const uint8_t seed[16]);
+
 void c_siphash_init(CSipHash *state, const uint8_t seed[16]);
+void c_siphash_init_key(CSipHash *state, const CSipHashKey *key);
 void c_siphash_append(CSipHash *state, const uint8_t *bytes, size_t n_bytes);
 uint64_t c_siphash_finalize(CSipHash *state);
 
 uint64_t c_siphash_hash(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes);
+uint64_t c_siphash_hash_key(const CSipHashKey *key, const uint8_t *bytes, size_t n_bytes);
+
+void c_siphash_append_u8(CSipHash *state, uint8_t v);
+void c_siphash_append_u16(CSipHash *state, uint16_t v);
+void c_siphash_append_u32(CSipHash *state, uint32_t v);
+void c_siphash_append_u64(CSipHash *state, uint64_t v);
+void c_siphash_append_bool(CSipHash *state, bool v);
+#endif
+
+void c_siphash_append_str(CSipHash *state, const char *str, size_t *n_bytesp);
+uint64_t c_siphash_hash_str(const uint8_t seed[16], const char *str, size_t *n_bytesp);
+void c_siphash_append_ascii_casefold(CSipHash *state, const uint8_t *bytes, size_t n_bytes);
+uint64_t c_siphash_hash_ascii_casefold(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes);
+void c_siphash_append_copy(CSipHash *state, uint8_t *dst, const uint8_t *src, size_t n_bytes);
+size_t c_siphash_hash_prefixes(const uint8_t seed[16],
+                               const uint8_t *bytes,
+                               size_t n_bytes,
+                               uint8_t delim,
+                               uint64_t *hashes,
+                               size_t n_hashes);
+void c_siphash_prefix_init(CSipHashPrefix *prefix, const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes);
+uint64_t c_siphash_hash_from(const CSipHashPrefix *prefix, const uint8_t *bytes, size_t n_bytes);
+
+uint64_t c_siphash_hash_u32(const uint8_t seed[16], uint32_t v);
+uint64_t c_siphash_hash_u64(const uint8_t seed[16], uint64_t v);
+uint64_t c_siphash_hash_16(const uint8_t seed[16], const uint8_t bytes[16]);
+uint64_t c_siphash_hash_32(const uint8_t seed[16], const uint8_t bytes[32]);
+
+void c_siphash_init128(CSipHash *state, const uint8_t seed[16]);
+void c_siphash_finalize128(CSipHash *state, uint64_t hash[2]);
+void c_siphash_hash128(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes, uint64_t hash[2]);
+
+void c_siphash_hash_x4(const uint8_t seed[16],
+                       const uint8_t *const bytes[4],
+                       const size_t n_bytes[4],
+                       uint64_t hashes[4]);
+void c_siphash_hash_x8(const uint8_t seed[16],
+                       const uint8_t *const bytes[8],
+                       const size_t n_bytes[8],
+                       uint64_t hashes[8]);
+void c_siphash_hash_batch(const uint8_t seed[16],
+                          const uint8_t *const *bytes,
+                          const size_t *n_bytes,
+                          size_t n,
+                          uint64_t *hashes);
+void c_siphash_hash_multikey(const CSipHashKey *keys,
+                             size_t n_keys,
+                             const uint8_t *bytes,
+                             size_t n_bytes,
+                             uint64_t *hashes);
+
+/* hash value of invalid rows, not unique, see c_siphash_hash_column_varlen() */
+#define C_SIPHASH_COLUMN_NULL_HASH UINT64_C(0)
+
+void c_siphash_hash_column_varlen(const uint8_t seed[16],
+                                  const uint8_t *data,
+                                  const uint32_t *offsets,
+                                  size_t n,
+                                  const uint8_t *validity,
+                                  uint64_t *hashes);
+void c_siphash_hash_column_u64(const uint8_t seed[16], const uint64_t *values, size_t n, uint64_t *hashes);
+void c_siphash_hash_column_u32(const uint8_t seed[16], const uint32_t *values, size_t n, uint64_t *hashes);
+void c_siphash_hash_strided(const uint8_t seed[16],
+                            const void *base,
+                            size_t stride,
+                            size_t field_offset,
+                            size_t field_len,
+                            size_t n,
+                            uint64_t *hashes);
+void c_siphash_hash_rows(const uint8_t seed[16],
+                         const CSipHashColumn *columns,
+                         size_t n_columns,
+                         size_t n,
+                         uint64_t *hashes);
+
+void c_siphash13_init(CSipHash13 *state, const uint8_t seed[16]);
+void c_siphash13_append(CSipHash13 *state, const uint8_t *bytes, size_t n_bytes);
+uint64_t c_siphash13_finalize(CSipHash13 *state);
+uint64_t c_siphash13_hash(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes);
+
+void c_siphash_half_init(CSipHashHalf *state, const uint8_t seed[8]);
+void c_siphash_half_init64(CSipHashHalf *state, const uint8_t seed[8]);
+void c_siphash_half_append(CSipHashHalf *state, const uint8_t *bytes, size_t n_bytes);
+uint32_t c_siphash_half_finalize(CSipHashHalf *state);
+uint64_t c_siphash_half_finalize64(CSipHashHalf *state);
+uint32_t c_siphash_half_hash(const uint8_t seed[8], const uint8_t *bytes, size_t n_bytes);
+uint64_t c_siphash_half_hash64(const uint8_t seed[8], const uint8_t *bytes, size_t n_bytes);
+
+const char *c_siphash_get_implementation(void);
+int c_siphash_calibrate(const char *cache_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*
+ * If C_SIPHASH_INLINE is defined before including this header, the core API
+ * (including the typed appends) is provided as static inline functions,
+ * rather than as calls into the library. This allows the compiler to inline
+ * hashing of short keys into the caller, and specialize it for constant
+ * lengths. Both variants produce identical hashes.
+ */
+#if defined(C_SIPHASH_INLINE)
+#include "c-siphash-core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline void c_siphash_key_init(CSipHashKey *key, const uint8_t seed[16]) {
+        c_siphash_key_init_inline(key, seed);
+}
 
+static inline void c_siphash_init(CSipHash *state, const uint8_t seed[16]) {
+        c_siphash_init_inline(state, seed);
+}
+
+static inline void c_siphash_init_key(CSipHash *state, const CSipHashKey *key) {
+        c_siphash_init_key_inline(state, key);
+}
+
+static inline void c_siphash_append(CSipHash *state, const uint8_t *bytes, size_t n_bytes) {
+        c_siphash_append_inline(state, bytes, n_bytes);
+}
+
+static inline uint64_t c_siphash_finalize(CSipHash *state) {
+        return c_siphash_finalize_inline(state);
+}
+
+static inline uint64_t c_siphash_hash(const uint8_t seed[16], const uint8_t *bytes, size_t n_bytes) {
+        return c_siphash_hash_inline(seed, bytes, n_bytes);
+}
+
+static inline uint64_t c_siphash_hash_key(const CSipHashKey *key, const uint8_t *bytes, size_t n_bytes) {
+        return c_siphash_hash_key_inline(key, bytes, n_bytes);
+}
+
+static inline void c_siphash_append_u8(CSipHash *state, uint8_t v) {
+        c_siphash_append_word(state, v, sizeof(v));
+}
+
+static inline void c_siphash_append_u16(CSipHash *state, uint16_t v) {
+        c_siphash_append_word(state, v, sizeof(v));
+}
+
+static inline void c_siphash_append_u32(CSipHash *state, uint32_t v) {
+        c_siphash_append_word(state, v, sizeof(v));
+}
+
+static inline void c_siphash_append_u64(CSipHash *state, uint64_t v) {
+        c_siphash_append_word(state, v, sizeof(v));
+}
+
+static inline void c_siphash_append_bool(CSipHash *state, bool v) {
+        c_siphash_append_word(state, !!v, 1);
+}
 #ifdef __cplusplus
 }
 #endif
+#endif
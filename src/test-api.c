@@ -23,9 +23,159 @@ static void test_api(void) {
 
         hash2 = c_siphash_hash(seed, NULL, 0);
         assert(hash1 == hash2);
+
+        c_siphash_init(&state, seed);
+        c_siphash_append_str(&state, "", NULL);
+        assert(c_siphash_finalize(&state) == hash1);
+        assert(c_siphash_hash_str(seed, "", NULL) == hash1);
+
+        c_siphash_init(&state, seed);
+        c_siphash_append_ascii_casefold(&state, NULL, 0);
+        assert(c_siphash_finalize(&state) == hash1);
+        assert(c_siphash_hash_ascii_casefold(seed, NULL, 0) == hash1);
+
+        c_siphash_init(&state, seed);
+        c_siphash_append_copy(&state, NULL, NULL, 0);
+        assert(c_siphash_finalize(&state) == hash1);
+
+        assert(c_siphash_hash_prefixes(seed, NULL, 0, '/', NULL, 0) == 0);
+
+        {
+                CSipHashPrefix prefix = C_SIPHASH_PREFIX_NULL;
+
+                c_siphash_prefix_init(&prefix, seed, NULL, 0);
+                assert(c_siphash_hash_from(&prefix, NULL, 0) == hash1);
+        }
+
+        c_siphash_init(&state, seed);
+        c_siphash_append_u8(&state, 0);
+        c_siphash_append_u16(&state, 0);
+        c_siphash_append_u32(&state, 0);
+        c_siphash_append_u64(&state, 0);
+        c_siphash_append_bool(&state, false);
+        assert(c_siphash_finalize(&state) == c_siphash_hash(seed, (const uint8_t[16]){}, 16));
+}
+
+static void test_api_fixed(void) {
+        uint8_t seed[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+        uint8_t bytes[32] = {};
+
+        assert(c_siphash_hash_u32(seed, 0) == c_siphash_hash(seed, bytes, 4));
+        assert(c_siphash_hash_u64(seed, 0) == c_siphash_hash(seed, bytes, 8));
+        assert(c_siphash_hash_16(seed, bytes) == c_siphash_hash(seed, bytes, 16));
+        assert(c_siphash_hash_32(seed, bytes) == c_siphash_hash(seed, bytes, 32));
+}
+
+static void test_api_siphash128(void) {
+        CSipHash state = C_SIPHASH_NULL;
+        uint8_t seed[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+        uint64_t hash1[2], hash2[2];
+
+        c_siphash_init128(&state, seed);
+        c_siphash_append(&state, NULL, 0);
+        c_siphash_finalize128(&state, hash1);
+
+        c_siphash_hash128(seed, NULL, 0, hash2);
+        assert(hash1[0] == hash2[0]);
+        assert(hash1[1] == hash2[1]);
+}
+
+static void test_api_key(void) {
+        CSipHashKey key = C_SIPHASH_KEY_NULL;
+        uint64_t hash;
+        CSipHash state = C_SIPHASH_NULL;
+        uint8_t seed[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+
+        c_siphash_key_init(&key, seed);
+        c_siphash_init_key(&state, &key);
+        assert(c_siphash_finalize(&state) == 12552310112479190712ULL);
+        assert(c_siphash_hash_key(&key, NULL, 0) == 12552310112479190712ULL);
+
+        c_siphash_hash_multikey(&key, 1, NULL, 0, &hash);
+        assert(hash == 12552310112479190712ULL);
+}
+
+static void test_api_siphash13(void) {
+        CSipHash13 state = C_SIPHASH13_NULL;
+        uint8_t seed[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+        uint64_t hash1, hash2;
+
+        c_siphash13_init(&state, seed);
+        c_siphash13_append(&state, NULL, 0);
+        hash1 = c_siphash13_finalize(&state);
+
+        hash2 = c_siphash13_hash(seed, NULL, 0);
+        assert(hash1 == hash2);
+}
+
+static void test_api_siphash_half(void) {
+        CSipHashHalf state = C_SIPHASH_HALF_NULL;
+        uint8_t seed[] = { '0', '1', '2', '3', '4', '5', '6', '7' };
+        uint32_t hash1, hash2;
+        uint64_t hash3, hash4;
+
+        c_siphash_half_init(&state, seed);
+        c_siphash_half_append(&state, NULL, 0);
+        hash1 = c_siphash_half_finalize(&state);
+
+        hash2 = c_siphash_half_hash(seed, NULL, 0);
+        assert(hash1 == hash2);
+
+        c_siphash_half_init64(&state, seed);
+        c_siphash_half_append(&state, NULL, 0);
+        hash3 = c_siphash_half_finalize64(&state);
+
+        hash4 = c_siphash_half_hash64(seed, NULL, 0);
+        assert(hash3 == hash4);
+}
+
+static void test_api_batch(void) {
+        uint8_t seed[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+        const uint8_t *bytes[8] = {};
+        size_t n_bytes[8] = {};
+        uint64_t hashes[8];
+
+        c_siphash_hash_x4(seed, bytes, n_bytes, hashes);
+        assert(hashes[0] == 12552310112479190712ULL);
+        assert(hashes[3] == 12552310112479190712ULL);
+
+        c_siphash_hash_x8(seed, bytes, n_bytes, hashes);
+        assert(hashes[0] == 12552310112479190712ULL);
+        assert(hashes[7] == 12552310112479190712ULL);
+
+        c_siphash_hash_batch(seed, bytes, n_bytes, 3, hashes);
+        assert(hashes[0] == 12552310112479190712ULL);
+        assert(hashes[2] == 12552310112479190712ULL);
+
+        c_siphash_hash_column_varlen(seed, NULL, (const uint32_t[]){ 0, 0, 0 }, 2, NULL, hashes);
+        assert(hashes[0] == 12552310112479190712ULL);
+        assert(hashes[1] == 12552310112479190712ULL);
+
+        c_siphash_hash_column_u64(seed, (const uint64_t[]){ 0 }, 1, hashes);
+        assert(hashes[0] == c_siphash_hash_u64(seed, 0));
+
+        c_siphash_hash_column_u32(seed, (const uint32_t[]){ 0 }, 1, hashes);
+        assert(hashes[0] == c_siphash_hash_u32(seed, 0));
+
+        c_siphash_hash_strided(seed, seed, 1, 0, 0, 3, hashes);
+        assert(hashes[0] == 12552310112479190712ULL);
+        assert(hashes[2] == 12552310112479190712ULL);
+
+        c_siphash_hash_rows(seed, NULL, 0, 2, hashes);
+        assert(hashes[0] == 12552310112479190712ULL);
+        assert(hashes[1] == 12552310112479190712ULL);
+
+        assert(c_siphash_get_implementation());
+        assert(c_siphash_calibrate(NULL) == 0);
 }
 
 int main(int argc, char **argv) {
         test_api();
+        test_api_key();
+        test_api_fixed();
+        test_api_siphash128();
+        test_api_siphash13();
+        test_api_siphash_half();
+        test_api_batch();
         return 0;
 }
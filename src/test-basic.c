@@ -10,10 +10,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "c-siphash.h"
+#include "c-siphash-private.h"
 
 /* See https://131002.net/siphash/siphash.pdf, Appendix A. */
 static void do_reference_test(const uint8_t *in, size_t len, const uint8_t *key) {
+        CSipHashKey expanded = {};
         CSipHash state = {};
         uint64_t out;
         unsigned i, j;
@@ -51,6 +55,15 @@ static void do_reference_test(const uint8_t *in, size_t len, const uint8_t *key)
 
         /* verify c_siphash_hash() produces the same result */
         c_assert(out == c_siphash_hash(key, in, len));
+
+        /* verify the expanded key gives the same initial state and result */
+        c_siphash_key_init(&expanded, key);
+        c_siphash_init_key(&state, &expanded);
+        c_assert(state.v0 == 0x7469686173716475);
+        c_assert(state.v1 == 0x6b617f6d656e6665);
+        c_assert(state.v2 == 0x6b7f62616d677361);
+        c_assert(state.v3 == 0x7b6b696e727e6c7b);
+        c_assert(out == c_siphash_hash_key(&expanded, in, len));
 }
 
 static void test_reference(void) {
@@ -112,9 +125,477 @@ static void test_short_hashes(void) {
         }
 }
 
+static void test_typed(void) {
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        const uint8_t bytes[] = { 0xa1, 0xb2, 0xc3, 0xd4, 0xe5, 0xf6, 0x07, 0x18 };
+        CSipHash state1 = {}, state2 = {};
+        unsigned i;
+
+        /* typed appends, starting at every possible offset of the stream */
+        for (i = 0; i < 8; ++i) {
+                c_siphash_init(&state1, key);
+                c_siphash_init(&state2, key);
+                c_siphash_append(&state1, bytes, i);
+                c_siphash_append(&state2, bytes, i);
+
+                c_siphash_append(&state1, bytes, 1);
+                c_siphash_append_u8(&state2, 0xa1);
+                c_assert(memcmp(&state1, &state2, sizeof state1) == 0);
+
+                c_siphash_append(&state1, bytes, 2);
+                c_siphash_append_u16(&state2, 0xb2a1);
+                c_assert(memcmp(&state1, &state2, sizeof state1) == 0);
+
+                c_siphash_append(&state1, bytes, 4);
+                c_siphash_append_u32(&state2, 0xd4c3b2a1);
+                c_assert(memcmp(&state1, &state2, sizeof state1) == 0);
+
+                c_siphash_append(&state1, bytes, 8);
+                c_siphash_append_u64(&state2, 0x1807f6e5d4c3b2a1);
+                c_assert(memcmp(&state1, &state2, sizeof state1) == 0);
+
+                c_siphash_append(&state1, (const uint8_t[]){ 1 }, 1);
+                c_siphash_append_bool(&state2, 7);
+                c_assert(memcmp(&state1, &state2, sizeof state1) == 0);
+
+                c_assert(c_siphash_finalize(&state1) == c_siphash_finalize(&state2));
+        }
+}
+
+static void test_fixed(void) {
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        uint8_t in[32];
+        unsigned i, j;
+
+        for (i = 0; i < sizeof(in); ++i)
+                in[i] = i;
+
+        /* reference vectors for the 0x00, 0x01, ... message */
+        c_assert(c_siphash_hash_u32(key, 0x03020100) == 0xcf2794e0277187b7);
+        c_assert(c_siphash_hash_u64(key, 0x0706050403020100) == 0x93f5f5799a932462);
+        c_assert(c_siphash_hash_16(key, in) == 0x3f2acc7f57c29bdb);
+        c_assert(c_siphash_hash_32(key, in) == 0x7127512f72f27cce);
+
+        /* the fixed-size helpers must match the generic code for any data */
+        for (i = 0; i < 64; ++i) {
+                for (j = 0; j < sizeof(in); ++j)
+                        in[j] = i * 37 + j * 11;
+
+                c_assert(c_siphash_hash_u32(key, (uint32_t)c_siphash_read_le64(in)) == c_siphash_hash(key, in, 4));
+                c_assert(c_siphash_hash_u64(key, c_siphash_read_le64(in)) == c_siphash_hash(key, in, 8));
+                c_assert(c_siphash_hash_16(key, in) == c_siphash_hash(key, in, 16));
+                c_assert(c_siphash_hash_32(key, in) == c_siphash_hash(key, in, 32));
+        }
+}
+
+static void test_fragments(void) {
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        CSipHash state1 = {}, state2 = {};
+        uint8_t in[512];
+        size_t i, j, n, len, offset, x = 1;
+
+        for (i = 0; i < sizeof(in); ++i)
+                in[i] = i * 7;
+
+        /* fragments of pseudo-random lengths, including empty ones */
+        for (i = 0; i < 256; ++i) {
+                /* start at every alignment of the stream */
+                c_siphash_init(&state1, key);
+                c_siphash_init(&state2, key);
+                c_siphash_append(&state1, in, i % 8);
+                c_siphash_append(&state2, in, i % 8);
+
+                offset = 0;
+                n = 1 + i % 16;
+                for (j = 0; j < n; ++j) {
+                        x = x * 1103515245 + 12345;
+                        len = (x >> 16) % 33;
+                        c_siphash_append(&state2, in + offset, len);
+                        offset += len;
+                }
+
+                c_siphash_append(&state1, in, offset);
+                c_assert(memcmp(&state1, &state2, sizeof state1) == 0);
+                c_assert(c_siphash_finalize(&state1) == c_siphash_finalize(&state2));
+        }
+}
+
+static void test_str(void) {
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        CSipHash state1 = {}, state2 = {};
+        size_t i, j, k, n, page;
+        char buf[64], *str;
+        uint8_t *pages;
+
+        /* every length at every alignment, with garbage after the NUL */
+        memset(buf, 0xff, sizeof(buf));
+        for (i = 0; i < 8; ++i) {
+                for (j = 0; i + j < sizeof(buf); ++j) {
+                        str = buf + i;
+                        for (k = 0; k < j; ++k)
+                                str[k] = 'a' + (i + k) % 26;
+                        str[j] = 0;
+
+                        c_assert(c_siphash_hash_str(key, str, &n) ==
+                                 c_siphash_hash(key, (const uint8_t *)str, j));
+                        c_assert(n == j);
+                        c_assert(c_siphash_hash_str(key, str, NULL) ==
+                                 c_siphash_hash(key, (const uint8_t *)str, j));
+
+                        /* and after unaligned prefixes of the stream */
+                        for (k = 0; k < 8; ++k) {
+                                c_siphash_init(&state1, key);
+                                c_siphash_init(&state2, key);
+                                c_siphash_append(&state1, (const uint8_t *)buf, k);
+                                c_siphash_append(&state2, (const uint8_t *)buf, k);
+                                c_siphash_append(&state1, (const uint8_t *)str, j);
+                                c_siphash_append_str(&state2, str, NULL);
+                                c_assert(memcmp(&state1, &state2, sizeof state1) == 0);
+                        }
+
+                        memset(buf, 0xff, sizeof(buf));
+                }
+        }
+
+        /* strings right before an inaccessible page must not fault */
+        page = sysconf(_SC_PAGESIZE);
+        pages = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        c_assert(pages != MAP_FAILED);
+        c_assert(!mprotect(pages + page, page, PROT_NONE));
+
+        for (j = 0; j < 32; ++j) {
+                str = (char *)pages + page - j - 1;
+                memset(str, 'x', j);
+                str[j] = 0;
+                c_assert(c_siphash_hash_str(key, str, &n) == c_siphash_hash(key, (const uint8_t *)str, j));
+                c_assert(n == j);
+        }
+
+        munmap(pages, 2 * page);
+
+        /* heap strings, sized exactly, so memory checkers see every over-read */
+        for (i = 0; i < 8; ++i) {
+                for (j = 0; j < 18; ++j) {
+                        pages = malloc(i + j + 1);
+                        c_assert(pages);
+                        str = (char *)pages + i;
+                        memset(str, 'y', j);
+                        str[j] = 0;
+                        c_assert(c_siphash_hash_str(key, str, &n) == c_siphash_hash(key, (const uint8_t *)str, j));
+                        c_assert(n == j);
+                        free(pages);
+                }
+        }
+}
+
+static void test_casefold(void) {
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        CSipHash state1 = {}, state2 = {};
+        uint8_t in[256], lower[256];
+        size_t i, j;
+
+        /* all byte values, so every neighbour of the letter ranges is covered */
+        for (i = 0; i < sizeof(in); ++i) {
+                in[i] = i * 3 + 0x40;
+                lower[i] = (in[i] >= 'A' && in[i] <= 'Z') ? in[i] + 0x20 : in[i];
+        }
+
+        for (i = 0; i <= 64; ++i)
+                c_assert(c_siphash_hash_ascii_casefold(key, in + i, sizeof(in) - i) ==
+                         c_siphash_hash(key, lower + i, sizeof(in) - i));
+
+        /* split at every offset, to cover all alignments of the stream */
+        for (i = 0; i <= 40; ++i) {
+                for (j = 0; j <= i; ++j) {
+                        c_siphash_init(&state1, key);
+                        c_siphash_init(&state2, key);
+                        c_siphash_append(&state1, lower, j);
+                        c_siphash_append(&state1, lower + j, i - j);
+                        c_siphash_append_ascii_casefold(&state2, in, j);
+                        c_siphash_append_ascii_casefold(&state2, in + j, i - j);
+                        c_assert(memcmp(&state1, &state2, sizeof state1) == 0);
+                }
+        }
+
+        c_assert(c_siphash_hash_ascii_casefold(key, (const uint8_t *)"Content-Type", 12) ==
+                 c_siphash_hash(key, (const uint8_t *)"content-type", 12));
+        c_assert(c_siphash_hash_ascii_casefold(key, (const uint8_t *)"@[`{", 4) ==
+                 c_siphash_hash(key, (const uint8_t *)"@[`{", 4));
+}
+
+static void test_copy(void) {
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        CSipHash state1 = {}, state2 = {};
+        uint8_t in[128], out[128 + 8];
+        size_t i, j, k, n = 3 * 1024 * 1024;
+        uint8_t *src, *dst;
+
+        for (i = 0; i < sizeof(in); ++i)
+                in[i] = i * 7;
+
+        /* every length, after every unaligned prefix, to every alignment */
+        for (i = 0; i <= 64; ++i) {
+                for (j = 0; j < 8; ++j) {
+                        for (k = 0; k < 8; ++k) {
+                                memset(out, 0xaa, sizeof(out));
+                                c_siphash_init(&state1, key);
+                                c_siphash_init(&state2, key);
+                                c_siphash_append(&state1, in, j);
+                                c_siphash_append(&state2, in, j);
+
+                                c_siphash_append(&state1, in + 1, i);
+                                c_siphash_append_copy(&state2, out + k, in + 1, i);
+                                c_assert(memcmp(&state1, &state2, sizeof state1) == 0);
+                                c_assert(!memcmp(out + k, in + 1, i));
+                                c_assert(out[k + i] == 0xaa);
+                        }
+                }
+        }
+
+        /* large copies, which use streaming stores where available */
+        src = malloc(n);
+        dst = malloc(n + 8);
+        c_assert(src && dst);
+        for (i = 0; i < n; ++i)
+                src[i] = i * 13;
+
+        for (k = 0; k < 2; ++k) {
+                c_siphash_init(&state2, key);
+                c_siphash_append_copy(&state2, dst + k, src, n);
+                c_assert(!memcmp(dst + k, src, n));
+                c_assert(c_siphash_finalize(&state2) == c_siphash_hash(key, src, n));
+        }
+
+        free(dst);
+        free(src);
+}
+
+static void test_prefixes(void) {
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        static const char *paths[] = {
+                "",
+                "/",
+                "a",
+                "/a/b",
+                "a/b/",
+                "//x//",
+                "/usr/share/doc/c-siphash/README.md",
+                "aaaaaaa/bbbbbbbbbbbbbbb/c/dddddddddddddddddddddddd/eeeeeee/",
+        };
+        uint64_t hashes[64];
+        size_t i, j, k, n, len;
+        const char *p;
+
+        for (i = 0; i < C_ARRAY_SIZE(paths); ++i) {
+                p = paths[i];
+                len = strlen(p);
+
+                n = c_siphash_hash_prefixes(key, (const uint8_t *)p, len, '/', hashes, C_ARRAY_SIZE(hashes));
+
+                /* compare to every non-empty prefix ending before '/' or at the end */
+                for (j = 1, k = 0; j <= len; ++j) {
+                        if (j < len && p[j] != '/')
+                                continue;
+
+                        c_assert(k < n);
+                        c_assert(hashes[k] == c_siphash_hash(key, (const uint8_t *)p, j));
+                        ++k;
+                }
+                c_assert(k == n);
+
+                /* truncated output still reports the total count */
+                for (j = 0; j <= n; ++j) {
+                        memset(hashes, 0, sizeof(hashes));
+                        c_assert(c_siphash_hash_prefixes(key, (const uint8_t *)p, len, '/', hashes, j) == n);
+                        for (k = j; k < C_ARRAY_SIZE(hashes); ++k)
+                                c_assert(hashes[k] == 0);
+                }
+        }
+}
+
+static void test_prefix(void) {
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        CSipHashPrefix prefix = C_SIPHASH_PREFIX_NULL;
+        uint8_t in[128];
+        size_t i, j;
+
+        for (i = 0; i < sizeof(in); ++i)
+                in[i] = i * 11 + 3;
+
+        /* every alignment of the prefix, with every suffix length around it */
+        for (i = 0; i <= 40; ++i) {
+                c_siphash_prefix_init(&prefix, key, in, i);
+
+                for (j = 0; j < 48; ++j)
+                        c_assert(c_siphash_hash_from(&prefix, in + i, j) == c_siphash_hash(key, in, i + j));
+        }
+}
+
+/*
+ * There are no official SipHash-1-3 vectors in the SipHash paper. These match
+ * the widely used ones (e.g., of the Rust standard library), for a message
+ * of bytes 0x00, 0x01, ... truncated to the given length.
+ */
+static void test_siphash13(void) {
+        static const struct {
+                size_t n_bytes;
+                uint64_t hash;
+        } vectors[] = {
+                {  0, 0xabac0158050fc4dc },
+                {  1, 0xc9f49bf37d57ca93 },
+                {  7, 0xd3927d989bb11140 },
+                {  8, 0x369095118d299a8e },
+                { 15, 0xd320d86d2a519956 },
+                { 16, 0xcc4fdd1a7d908b66 },
+                { 31, 0x2370dd1f8c21d1bc },
+                { 63, 0x9d199062b7bbb3a8 },
+        };
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        CSipHash13 state = C_SIPHASH13_NULL;
+        uint8_t in[64];
+        unsigned i, j;
+
+        for (i = 0; i < sizeof(in); ++i)
+                in[i] = i;
+
+        for (i = 0; i < C_ARRAY_SIZE(vectors); ++i) {
+                c_assert(c_siphash13_hash(key, in, vectors[i].n_bytes) == vectors[i].hash);
+
+                /* verify that splitting the input gives the same result */
+                for (j = 0; j <= vectors[i].n_bytes; ++j) {
+                        c_siphash13_init(&state, key);
+                        c_siphash13_append(&state, in, j);
+                        c_siphash13_append(&state, in + j, vectors[i].n_bytes - j);
+                        c_assert(c_siphash13_finalize(&state) == vectors[i].hash);
+                }
+
+                /* and that it differs from SipHash24 */
+                c_assert(c_siphash_hash(key, in, vectors[i].n_bytes) != vectors[i].hash);
+        }
+}
+
+/*
+ * See the reference implementation of SipHash for these vectors, which hash a
+ * message of bytes 0x00, 0x01, ... truncated to the given length.
+ */
+static void test_siphash128(void) {
+        static const struct {
+                size_t n_bytes;
+                uint8_t hash[16];
+        } vectors[] = {
+                {  0, { 0xa3, 0x81, 0x7f, 0x04, 0xba, 0x25, 0xa8, 0xe6, 0x6d, 0xf6, 0x72, 0x14, 0xc7, 0x55, 0x02, 0x93 } },
+                {  1, { 0xda, 0x87, 0xc1, 0xd8, 0x6b, 0x99, 0xaf, 0x44, 0x34, 0x76, 0x59, 0x11, 0x9b, 0x22, 0xfc, 0x45 } },
+                {  7, { 0xa1, 0xf1, 0xeb, 0xbe, 0xd8, 0xdb, 0xc1, 0x53, 0xc0, 0xb8, 0x4a, 0xa6, 0x1f, 0xf0, 0x82, 0x39 } },
+                {  8, { 0x3b, 0x62, 0xa9, 0xba, 0x62, 0x58, 0xf5, 0x61, 0x0f, 0x83, 0xe2, 0x64, 0xf3, 0x14, 0x97, 0xb4 } },
+                { 15, { 0x54, 0x93, 0xe9, 0x99, 0x33, 0xb0, 0xa8, 0x11, 0x7e, 0x08, 0xec, 0x0f, 0x97, 0xcf, 0xc3, 0xd9 } },
+                { 16, { 0x6e, 0xe2, 0xa4, 0xca, 0x67, 0xb0, 0x54, 0xbb, 0xfd, 0x33, 0x15, 0xbf, 0x85, 0x23, 0x05, 0x77 } },
+                { 63, { 0x51, 0x50, 0xd1, 0x77, 0x2f, 0x50, 0x83, 0x4a, 0x50, 0x3e, 0x06, 0x9a, 0x97, 0x3f, 0xbd, 0x7c } },
+        };
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        CSipHash state = C_SIPHASH_NULL;
+        uint64_t hash[2], expected[2];
+        uint8_t in[64];
+        unsigned i, j;
+
+        for (i = 0; i < sizeof(in); ++i)
+                in[i] = i;
+
+        for (i = 0; i < C_ARRAY_SIZE(vectors); ++i) {
+                expected[0] = 0;
+                expected[1] = 0;
+                for (j = 0; j < 8; ++j) {
+                        expected[0] |= (uint64_t)vectors[i].hash[j] << (j * 8);
+                        expected[1] |= (uint64_t)vectors[i].hash[j + 8] << (j * 8);
+                }
+
+                c_siphash_hash128(key, in, vectors[i].n_bytes, hash);
+                c_assert(hash[0] == expected[0]);
+                c_assert(hash[1] == expected[1]);
+
+                /* verify that splitting the input gives the same result */
+                for (j = 0; j <= vectors[i].n_bytes; ++j) {
+                        c_siphash_init128(&state, key);
+                        c_siphash_append(&state, in, j);
+                        c_siphash_append(&state, in + j, vectors[i].n_bytes - j);
+                        c_siphash_finalize128(&state, hash);
+                        c_assert(hash[0] == expected[0]);
+                        c_assert(hash[1] == expected[1]);
+                }
+        }
+}
+
+/*
+ * See the reference implementation of HalfSipHash for these vectors, which
+ * hash a message of bytes 0x00, 0x01, ... truncated to the given length, with
+ * a key of bytes 0x00, ..., 0x07. The values are the little-endian reading of
+ * the reference byte output.
+ */
+static void test_siphash_half(void) {
+        static const struct {
+                size_t n_bytes;
+                uint32_t hash;
+                uint64_t hash64;
+        } vectors[] = {
+                {  0, 0x5b9f35a9, 0xc83cb8b9591f8d21 },
+                {  1, 0xb85a4727, 0x157338f8122455be },
+                {  3, 0x04e7fe8a, 0x790606f7451a0fce },
+                {  4, 0x89466e2a, 0xa12ee55b178ae7d5 },
+                {  7, 0xc563cf8b, 0x84c67bb0282720ff },
+                {  8, 0x8f84b8d0, 0x8c85e4bc20e8feed },
+                { 15, 0x972bfe74, 0x02c9814ecb0b7d21 },
+                { 63, 0x744aea59, 0x876032bf713ca62e },
+        };
+        const uint8_t key[8] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+        CSipHashHalf state = C_SIPHASH_HALF_NULL;
+        uint8_t in[64];
+        unsigned i, j;
+
+        for (i = 0; i < sizeof(in); ++i)
+                in[i] = i;
+
+        for (i = 0; i < C_ARRAY_SIZE(vectors); ++i) {
+                c_assert(c_siphash_half_hash(key, in, vectors[i].n_bytes) == vectors[i].hash);
+                c_assert(c_siphash_half_hash64(key, in, vectors[i].n_bytes) == vectors[i].hash64);
+
+                /* verify that splitting the input gives the same result */
+                for (j = 0; j <= vectors[i].n_bytes; ++j) {
+                        c_siphash_half_init(&state, key);
+                        c_siphash_half_append(&state, in, j);
+                        c_siphash_half_append(&state, in + j, vectors[i].n_bytes - j);
+                        c_assert(c_siphash_half_finalize(&state) == vectors[i].hash);
+
+                        c_siphash_half_init64(&state, key);
+                        c_siphash_half_append(&state, in, j);
+                        c_siphash_half_append(&state, in + j, vectors[i].n_bytes - j);
+                        c_assert(c_siphash_half_finalize64(&state) == vectors[i].hash64);
+                }
+        }
+}
+
 int main(int argc, char *argv[]) {
         test_reference();
         test_short_hashes();
+        test_typed();
+        test_fixed();
+        test_fragments();
+        test_str();
+        test_casefold();
+        test_copy();
+        test_prefixes();
+        test_prefix();
+        test_siphash13();
+        test_siphash128();
+        test_siphash_half();
 
         return 0;
 }
@@ -0,0 +1,211 @@
+/*
+ * Tests for Batch Hashing
+ * This test hashes sets of independent messages through the batch APIs and
+ * verifies the results match hashing each message on its own. Message lengths
+ * are mixed, to make sure lanes of unequal length are handled correctly. All
+ * tests are run with every implementation the CPU supports.
+ */
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "c-siphash.h"
+#include "c-siphash-private.h"
+
+static const uint8_t test_seed[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                       0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+static uint8_t test_data[256];
+
+static void test_x4(void) {
+        const uint8_t *bytes[4];
+        size_t i, j, n_bytes[4];
+        uint64_t hashes[4];
+
+        /* all lanes with equal lengths */
+        for (i = 0; i < 64; ++i) {
+                for (j = 0; j < 4; ++j) {
+                        bytes[j] = test_data + j;
+                        n_bytes[j] = i;
+                }
+
+                c_siphash_hash_x4(test_seed, bytes, n_bytes, hashes);
+                for (j = 0; j < 4; ++j)
+                        c_assert(hashes[j] == c_siphash_hash(test_seed, bytes[j], n_bytes[j]));
+        }
+
+        /* lanes with unequal lengths, finishing in every possible order */
+        for (i = 0; i < 1024; ++i) {
+                for (j = 0; j < 4; ++j) {
+                        bytes[j] = test_data + ((i * 7 + j * 13) % 64);
+                        n_bytes[j] = (i * (j + 3) + j * 29) % 97;
+                }
+
+                c_siphash_hash_x4(test_seed, bytes, n_bytes, hashes);
+                for (j = 0; j < 4; ++j)
+                        c_assert(hashes[j] == c_siphash_hash(test_seed, bytes[j], n_bytes[j]));
+        }
+}
+
+static void test_x8(void) {
+        const uint8_t *bytes[8];
+        size_t i, j, n_bytes[8];
+        uint64_t hashes[8];
+
+        /* all lanes with equal lengths */
+        for (i = 0; i < 64; ++i) {
+                for (j = 0; j < 8; ++j) {
+                        bytes[j] = test_data + j;
+                        n_bytes[j] = i;
+                }
+
+                c_siphash_hash_x8(test_seed, bytes, n_bytes, hashes);
+                for (j = 0; j < 8; ++j)
+                        c_assert(hashes[j] == c_siphash_hash(test_seed, bytes[j], n_bytes[j]));
+        }
+
+        /* lanes with unequal lengths, finishing in every possible order */
+        for (i = 0; i < 1024; ++i) {
+                for (j = 0; j < 8; ++j) {
+                        bytes[j] = test_data + ((i * 7 + j * 13) % 64);
+                        n_bytes[j] = (i * (j + 3) + j * 29) % 97;
+                }
+
+                c_siphash_hash_x8(test_seed, bytes, n_bytes, hashes);
+                for (j = 0; j < 8; ++j)
+                        c_assert(hashes[j] == c_siphash_hash(test_seed, bytes[j], n_bytes[j]));
+        }
+}
+
+static void test_batch(void) {
+        const uint8_t *bytes[67];
+        size_t i, j, n_bytes[67];
+        uint64_t hashes[67];
+
+        for (i = 0; i < C_ARRAY_SIZE(bytes); ++i) {
+                bytes[i] = test_data + (i * 5) % 128;
+                n_bytes[i] = (i * 11) % 89;
+        }
+
+        /* every batch size, to cover all splits into kernel groups */
+        for (i = 0; i <= C_ARRAY_SIZE(bytes); ++i) {
+                memset(hashes, 0, sizeof(hashes));
+                c_siphash_hash_batch(test_seed, bytes, n_bytes, i, hashes);
+                for (j = 0; j < i; ++j)
+                        c_assert(hashes[j] == c_siphash_hash(test_seed, bytes[j], n_bytes[j]));
+                for ( ; j < C_ARRAY_SIZE(bytes); ++j)
+                        c_assert(hashes[j] == 0);
+        }
+}
+
+/*
+ * Batches span several bucketing chunks. The first third has blobs of one
+ * length class, which is hashed in place, the rest has mixed lengths, which
+ * are reordered and must be scattered back.
+ */
+static void test_batch_bucketed(void) {
+        const uint8_t *bytes[601];
+        size_t i, n_bytes[601];
+        uint64_t hashes[601];
+
+        for (i = 0; i < C_ARRAY_SIZE(bytes); ++i) {
+                bytes[i] = test_data + (i * 3) % 64;
+                n_bytes[i] = (i < 200) ? 16 + i % 16 : (i * i * 7) % 193;
+        }
+
+        c_siphash_hash_batch(test_seed, bytes, n_bytes, C_ARRAY_SIZE(bytes), hashes);
+        for (i = 0; i < C_ARRAY_SIZE(bytes); ++i)
+                c_assert(hashes[i] == c_siphash_hash(test_seed, bytes[i], n_bytes[i]));
+}
+
+/* every number of keys up to two full AVX-512 passes plus remainder */
+static void test_multikey(void) {
+        CSipHashKey keys[27];
+        uint8_t seed[16];
+        uint64_t hashes[27];
+        size_t i, k, n;
+
+        for (k = 0; k < C_ARRAY_SIZE(keys); ++k) {
+                for (i = 0; i < sizeof(seed); ++i)
+                        seed[i] = k * 31 + i;
+                c_siphash_key_init(&keys[k], seed);
+        }
+
+        for (n = 0; n < 40; ++n) {
+                for (k = 0; k <= C_ARRAY_SIZE(keys); ++k) {
+                        memset(hashes, 0, sizeof(hashes));
+                        c_siphash_hash_multikey(keys, k, test_data + n, n, hashes);
+                        for (i = 0; i < k; ++i)
+                                c_assert(hashes[i] == c_siphash_hash_key(&keys[i], test_data + n, n));
+                        for ( ; i < C_ARRAY_SIZE(hashes); ++i)
+                                c_assert(hashes[i] == 0);
+                }
+        }
+}
+
+static void test_calibrate(void) {
+        char path[] = "/tmp/test-batch-XXXXXX";
+        FILE *f;
+        int r, fd;
+
+        fd = mkstemp(path);
+        c_assert(fd >= 0);
+        close(fd);
+
+        /* an empty cache is ignored and overwritten */
+        r = c_siphash_calibrate(path);
+        c_assert(!r);
+        test_batch();
+
+        /* a valid cache is used as is */
+        r = c_siphash_calibrate(path);
+        c_assert(!r);
+        test_batch();
+
+        /* a cache for different kernels is ignored */
+        f = fopen(path, "we");
+        c_assert(f);
+        fprintf(f, "c-siphash-calibration-1 invalid 1 1 1 1 1 1 1\n");
+        fclose(f);
+        r = c_siphash_calibrate(path);
+        c_assert(!r);
+        test_batch();
+
+        unlink(path);
+
+        /* unwritable caches are reported, but still calibrate */
+        r = c_siphash_calibrate("/dev/null/invalid");
+        c_assert(r < 0);
+        test_batch();
+}
+
+int main(int argc, char *argv[]) {
+        const CSipHashImpl *impl;
+        size_t i;
+
+        for (i = 0; i < sizeof(test_data); ++i)
+                test_data[i] = i * 37 + 11;
+
+        for (i = 0; i < c_siphash_n_impls; ++i) {
+                impl = &c_siphash_impls[i];
+                if (!impl->supported()) {
+                        fprintf(stderr, "Skipping unsupported implementation: %s\n", impl->name);
+                        continue;
+                }
+
+                c_siphash_impl_set(impl);
+                c_assert(!strcmp(c_siphash_get_implementation(), impl->name));
+
+                test_x4();
+                test_x8();
+                test_batch();
+                test_batch_bucketed();
+                test_multikey();
+                test_calibrate();
+        }
+
+        return 0;
+}
@@ -0,0 +1,553 @@
+/*
+ * Benchmarks
+ * This measures the throughput of the hashing APIs for a range of input
+ * sizes, and prints the cost per byte. It is registered as a benchmark rather
+ * than a test, so it only runs via `meson test --benchmark`. On x86, the cost
+ * is measured in time-stamp-counter cycles, otherwise in nanoseconds.
+ */
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "c-siphash.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define BENCH_UNIT "cycles"
+#  define bench_now() __builtin_ia32_rdtsc()
+#else
+#  define BENCH_UNIT "ns"
+static uint64_t bench_now(void) {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+#define BENCH_BYTES (UINT64_C(64) * 1024 * 1024)
+
+static const uint8_t bench_seed[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+static uint8_t bench_data[4 * 1024 * 1024];
+static volatile uint64_t bench_sink;
+
+static void bench_report(const char *name, size_t size, uint64_t cost, uint64_t n_bytes) {
+        printf("%-32s %8zu bytes: %8.3f %s/byte\n", name, size, (double)cost / n_bytes, BENCH_UNIT);
+}
+
+/* hash the buffer at once */
+static void bench_hash(size_t size) {
+        uint64_t start, i, n = c_max(BENCH_BYTES / size, UINT64_C(1));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                bench_sink += c_siphash_hash(bench_seed, bench_data, size);
+        bench_report("c_siphash_hash()", size, bench_now() - start, n * size);
+}
+
+static void bench_hash13(size_t size) {
+        uint64_t start, i, n = c_max(BENCH_BYTES / size, UINT64_C(1));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                bench_sink += c_siphash13_hash(bench_seed, bench_data, size);
+        bench_report("c_siphash13_hash()", size, bench_now() - start, n * size);
+}
+
+static void bench_hash_half(size_t size) {
+        uint64_t start, i, n = c_max(BENCH_BYTES / size, UINT64_C(1));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                bench_sink += c_siphash_half_hash(bench_seed, bench_data, size);
+        bench_report("c_siphash_half_hash()", size, bench_now() - start, n * size);
+}
+
+/*
+ * Hash short fixed-size keys, one after another, with the generic and the
+ * fixed-size entry points. Each key depends on the previous hash, so this
+ * measures latency rather than throughput, as seen by point lookups.
+ */
+static void bench_fixed(void) {
+        uint64_t start, i, h, n = BENCH_BYTES / 64;
+        uint8_t key[32] = {};
+
+        for (h = 0, start = bench_now(), i = 0; i < n; ++i) {
+                memcpy(key, &h, sizeof(h));
+                h = c_siphash_hash(bench_seed, key, 8);
+        }
+        bench_report("c_siphash_hash()", 8, bench_now() - start, n * 8);
+
+        for (h = 0, start = bench_now(), i = 0; i < n; ++i)
+                h = c_siphash_hash_u64(bench_seed, h);
+        bench_report("c_siphash_hash_u64()", 8, bench_now() - start, n * 8);
+
+        for (h = 0, start = bench_now(), i = 0; i < n; ++i) {
+                memcpy(key, &h, sizeof(h));
+                h = c_siphash_hash(bench_seed, key, 16);
+        }
+        bench_report("c_siphash_hash()", 16, bench_now() - start, n * 16);
+
+        for (h = 0, start = bench_now(), i = 0; i < n; ++i) {
+                memcpy(key, &h, sizeof(h));
+                h = c_siphash_hash_16(bench_seed, key);
+        }
+        bench_report("c_siphash_hash_16()", 16, bench_now() - start, n * 16);
+
+        bench_sink += h;
+}
+
+/*
+ * Hash a set of short messages of mixed lengths, one by one and as a batch.
+ * The lengths are drawn from a fixed pseudo-random sequence between 0 and 255
+ * bytes, like keys of a hash table. @size is the total size of the set.
+ */
+static void bench_batch(size_t size) {
+        static const uint8_t *bytes[4096];
+        static size_t n_bytes[4096];
+        static uint64_t hashes[4096];
+        uint64_t start, i, n, total = 0, x = 1;
+        size_t j, n_msgs = 0;
+
+        while (n_msgs < C_ARRAY_SIZE(bytes) && total < size) {
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+                bytes[n_msgs] = bench_data + total;
+                n_bytes[n_msgs] = (x >> 33) % 256;
+                total += n_bytes[n_msgs++];
+        }
+
+        n = c_max(BENCH_BYTES / total, UINT64_C(1));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                for (j = 0; j < n_msgs; ++j)
+                        bench_sink += c_siphash_hash(bench_seed, bytes[j], n_bytes[j]);
+        bench_report("c_siphash_hash(mixed)", size, bench_now() - start, n * total);
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                c_siphash_hash_batch(bench_seed, bytes, n_bytes, n_msgs, hashes);
+                bench_sink += hashes[0];
+        }
+        bench_report("c_siphash_hash_batch()", size, bench_now() - start, n * total);
+}
+
+/*
+ * Hash a column of variable-length values, with the same lengths as
+ * bench_batch(), one row at a time and as a column.
+ */
+static void bench_column_varlen(size_t size) {
+        static uint32_t offsets[4097];
+        static uint64_t hashes[4096];
+        uint64_t start, i, n, x = 1;
+        size_t j, n_rows = 0;
+
+        while (n_rows < C_ARRAY_SIZE(hashes) && offsets[n_rows] < size) {
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+                offsets[n_rows + 1] = offsets[n_rows] + (x >> 33) % 256;
+                ++n_rows;
+        }
+
+        n = c_max(BENCH_BYTES / offsets[n_rows], UINT64_C(1));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                for (j = 0; j < n_rows; ++j)
+                        bench_sink += c_siphash_hash(bench_seed, bench_data + offsets[j], offsets[j + 1] - offsets[j]);
+        bench_report("c_siphash_hash(rows)", size, bench_now() - start, n * offsets[n_rows]);
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                c_siphash_hash_column_varlen(bench_seed, bench_data, offsets, n_rows, NULL, hashes);
+                bench_sink += hashes[0];
+        }
+        bench_report("c_siphash_hash_column_varlen()", size, bench_now() - start, n * offsets[n_rows]);
+}
+
+/* hash a column of 64bit and 32bit integers, one by one and as a column */
+static void bench_column_fixed(void) {
+        static uint64_t hashes[4096], values64[4096];
+        static uint32_t values32[4096];
+        uint64_t start, i, n = BENCH_BYTES / (8 * C_ARRAY_SIZE(hashes));
+        size_t j;
+
+        /* copy, rather than cast, the data, for alignment and strict aliasing */
+        memcpy(values64, bench_data, sizeof(values64));
+        memcpy(values32, bench_data, sizeof(values32));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                for (j = 0; j < C_ARRAY_SIZE(hashes); ++j)
+                        bench_sink += c_siphash_hash_u64(bench_seed, values64[j]);
+        bench_report("c_siphash_hash_u64(rows)", 8, bench_now() - start, n * 8 * C_ARRAY_SIZE(hashes));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                c_siphash_hash_column_u64(bench_seed, values64, C_ARRAY_SIZE(hashes), hashes);
+                bench_sink += hashes[0];
+        }
+        bench_report("c_siphash_hash_column_u64()", 8, bench_now() - start, n * 8 * C_ARRAY_SIZE(hashes));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                for (j = 0; j < C_ARRAY_SIZE(hashes); ++j)
+                        bench_sink += c_siphash_hash_u32(bench_seed, values32[j]);
+        bench_report("c_siphash_hash_u32(rows)", 4, bench_now() - start, n * 4 * C_ARRAY_SIZE(hashes));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                c_siphash_hash_column_u32(bench_seed, values32, C_ARRAY_SIZE(hashes), hashes);
+                bench_sink += hashes[0];
+        }
+        bench_report("c_siphash_hash_column_u32()", 4, bench_now() - start, n * 4 * C_ARRAY_SIZE(hashes));
+}
+
+/*
+ * Hash a @len byte field at offset 8 of 4096 records of 48 bytes, one record
+ * at a time and in place.
+ */
+static void bench_strided(size_t len) {
+        static uint64_t hashes[4096];
+        uint64_t start, i, n = BENCH_BYTES / (len * C_ARRAY_SIZE(hashes));
+        size_t j;
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                for (j = 0; j < C_ARRAY_SIZE(hashes); ++j)
+                        bench_sink += c_siphash_hash(bench_seed, bench_data + j * 48 + 8, len);
+        bench_report("c_siphash_hash(records)", len, bench_now() - start, n * len * C_ARRAY_SIZE(hashes));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                c_siphash_hash_strided(bench_seed, bench_data, 48, 8, len, C_ARRAY_SIZE(hashes), hashes);
+                bench_sink += hashes[0];
+        }
+        bench_report("c_siphash_hash_strided()", len, bench_now() - start, n * len * C_ARRAY_SIZE(hashes));
+}
+
+/*
+ * Hash 4096 rows of a (u32, u64, string) key, by serializing each row into a
+ * buffer, and by streaming the columns into the row states.
+ */
+static void bench_rows(void) {
+        static uint32_t offsets[4097];
+        static uint64_t hashes[4096];
+        const CSipHashColumn columns[] = {
+                { .data = bench_data, .width = 4 },
+                { .data = bench_data + 65536, .width = 8 },
+                { .data = bench_data + 131072, .offsets = offsets },
+        };
+        uint64_t start, i, n, len;
+        uint8_t buffer[64];
+        size_t j, n_buffer;
+
+        for (j = 0; j < C_ARRAY_SIZE(hashes); ++j)
+                offsets[j + 1] = offsets[j] + 2 + (j * 7) % 14;
+
+        n = BENCH_BYTES / (12 * C_ARRAY_SIZE(hashes) + offsets[C_ARRAY_SIZE(hashes)]);
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                for (j = 0; j < C_ARRAY_SIZE(hashes); ++j) {
+                        memcpy(buffer, columns[0].data + j * 4, 4);
+                        memcpy(buffer + 4, columns[1].data + j * 8, 8);
+                        len = offsets[j + 1] - offsets[j];
+                        memcpy(buffer + 12, &len, 8);
+                        memcpy(buffer + 20, columns[2].data + offsets[j], len);
+                        n_buffer = 20 + len;
+                        bench_sink += c_siphash_hash(bench_seed, buffer, n_buffer);
+                }
+        }
+        bench_report("c_siphash_hash(serialized)", 4096, bench_now() - start,
+                     n * (12 * C_ARRAY_SIZE(hashes) + offsets[C_ARRAY_SIZE(hashes)]));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                c_siphash_hash_rows(bench_seed, columns, C_ARRAY_SIZE(columns), C_ARRAY_SIZE(hashes), hashes);
+                bench_sink += hashes[0];
+        }
+        bench_report("c_siphash_hash_rows()", 4096, bench_now() - start,
+                     n * (12 * C_ARRAY_SIZE(hashes) + offsets[C_ARRAY_SIZE(hashes)]));
+}
+
+/*
+ * Hash a @size byte message with 8 keys, one key at a time, and with all
+ * keys at once. The cost is reported per byte of the message.
+ */
+static void bench_multikey(size_t size) {
+        uint64_t start, i, hashes[8], n = c_max(BENCH_BYTES / (8 * size), UINT64_C(1));
+        CSipHashKey keys[8];
+        size_t k;
+
+        for (k = 0; k < C_ARRAY_SIZE(keys); ++k)
+                c_siphash_key_init(&keys[k], bench_data + k * 16);
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                for (k = 0; k < C_ARRAY_SIZE(keys); ++k)
+                        bench_sink += c_siphash_hash_key(&keys[k], bench_data, size);
+        bench_report("c_siphash_hash_key(x8)", size, bench_now() - start, n * size);
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                c_siphash_hash_multikey(keys, C_ARRAY_SIZE(keys), bench_data, size, hashes);
+                bench_sink += hashes[0];
+        }
+        bench_report("c_siphash_hash_multikey(8)", size, bench_now() - start, n * size);
+}
+
+/*
+ * Hash a 1500 byte packet, split into fragments of unaligned lengths, by
+ * appending fragments one by one, and at once.
+ */
+static void bench_fragments(void) {
+        static const size_t lengths[] = { 14, 20, 8, 301, 157, 500, 413, 87 };
+        uint64_t start, i, n = BENCH_BYTES / 1500;
+        size_t j, offset;
+        CSipHash state;
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                c_siphash_init(&state, bench_seed);
+                for (j = 0, offset = 0; j < C_ARRAY_SIZE(lengths); offset += lengths[j++])
+                        c_siphash_append(&state, bench_data + offset, lengths[j]);
+                bench_sink += c_siphash_finalize(&state);
+        }
+        bench_report("c_siphash_append(fragments)", 1500, bench_now() - start, n * 1500);
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                bench_sink += c_siphash_hash(bench_seed, bench_data, 1500);
+        bench_report("c_siphash_hash()", 1500, bench_now() - start, n * 1500);
+}
+
+/*
+ * Hash a set of NUL-terminated strings of 1 to 47 bytes, with strlen() and
+ * c_siphash_hash(), and with c_siphash_hash_str().
+ */
+static void bench_str(void) {
+        static char strings[4096];
+        uint64_t start, i, n = BENCH_BYTES / sizeof(strings);
+        size_t j, len;
+
+        for (j = 0; j < sizeof(strings); ++j)
+                strings[j] = (j * 7 % 48) ? 'a' + j % 26 : 0;
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                for (j = 0; j < sizeof(strings); j += len + 1) {
+                        len = strlen(strings + j);
+                        bench_sink += c_siphash_hash(bench_seed, (const uint8_t *)strings + j, len);
+                }
+        }
+        bench_report("strlen() + c_siphash_hash()", sizeof(strings), bench_now() - start, n * sizeof(strings));
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                for (j = 0; j < sizeof(strings); j += len + 1)
+                        bench_sink += c_siphash_hash_str(bench_seed, strings + j, &len);
+        }
+        bench_report("c_siphash_hash_str()", sizeof(strings), bench_now() - start, n * sizeof(strings));
+}
+
+/*
+ * Hash mixed-case identifiers of @size bytes case-insensitively, by
+ * lowercasing into a buffer first, and in the word loop.
+ */
+static void bench_casefold(size_t size) {
+        uint64_t start, i, n = c_max(BENCH_BYTES / size, UINT64_C(1));
+        static uint8_t input[256], lower[256];
+        size_t j;
+
+        for (j = 0; j < size; ++j)
+                input[j] = (j % 3) ? 'A' + j % 26 : 'a' + j % 26;
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                for (j = 0; j < size; ++j)
+                        lower[j] = (input[j] >= 'A' && input[j] <= 'Z') ? input[j] + 0x20 : input[j];
+                bench_sink += c_siphash_hash(bench_seed, lower, size);
+        }
+        bench_report("tolower() + c_siphash_hash()", size, bench_now() - start, n * size);
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                bench_sink += c_siphash_hash_ascii_casefold(bench_seed, input, size);
+        bench_report("c_siphash_hash_ascii_casefold()", size, bench_now() - start, n * size);
+}
+
+/*
+ * Hash all prefixes of a path of @n_components components of 11 bytes each,
+ * with c_siphash_hash() per prefix, and in one pass.
+ */
+static void bench_prefixes(size_t n_components) {
+        static uint8_t path[16 * 12];
+        static uint64_t hashes[16];
+        uint64_t start, i, n, size = n_components * 12;
+        size_t j;
+
+        n = BENCH_BYTES / size;
+        for (j = 0; j < size; ++j)
+                path[j] = (j % 12) ? 'a' + j % 26 : '/';
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                for (j = 1; j <= n_components; ++j)
+                        bench_sink += c_siphash_hash(bench_seed, path, j * 12);
+        bench_report("c_siphash_hash() per prefix", size, bench_now() - start, n * size);
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                c_siphash_hash_prefixes(bench_seed, path, size, '/', hashes, C_ARRAY_SIZE(hashes));
+                bench_sink += hashes[0];
+        }
+        bench_report("c_siphash_hash_prefixes()", size, bench_now() - start, n * size);
+}
+
+/*
+ * Hash keys of a common 36 byte namespace followed by @size bytes, once as a
+ * whole, and once from the state of the hashed namespace.
+ */
+static void bench_from(size_t size) {
+        static const char ns[] = "tenant-7f3a9c2e/table-orders/column:";
+        static uint8_t keys[256][64];
+        static const uint8_t *bytes[256];
+        uint64_t start, i, n = BENCH_BYTES / (size * C_ARRAY_SIZE(keys));
+        CSipHashPrefix prefix;
+        size_t j;
+
+        for (j = 0; j < C_ARRAY_SIZE(keys); ++j) {
+                memcpy(keys[j], ns, sizeof(ns) - 1);
+                memcpy(keys[j] + sizeof(ns) - 1, bench_data + j * size, size);
+                bytes[j] = keys[j] + sizeof(ns) - 1;
+        }
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                for (j = 0; j < C_ARRAY_SIZE(keys); ++j)
+                        bench_sink += c_siphash_hash(bench_seed, keys[j], sizeof(ns) - 1 + size);
+        bench_report("c_siphash_hash() of full key", size, bench_now() - start, n * size * C_ARRAY_SIZE(keys));
+
+        c_siphash_prefix_init(&prefix, bench_seed, (const uint8_t *)ns, sizeof(ns) - 1);
+
+        start = bench_now();
+        for (i = 0; i < n; ++i)
+                for (j = 0; j < C_ARRAY_SIZE(keys); ++j)
+                        bench_sink += c_siphash_hash_from(&prefix, bytes[j], size);
+        bench_report("c_siphash_hash_from()", size, bench_now() - start, n * size * C_ARRAY_SIZE(keys));
+}
+
+/*
+ * Copy @size bytes and hash them, via memcpy() followed by c_siphash_append(),
+ * and via c_siphash_append_copy(). The destination cycles through a buffer of
+ * 64MiB, like an arena would, so large copies do not stay in the cache.
+ */
+static void bench_copy(size_t size) {
+        uint64_t start, i, n = c_max(BENCH_BYTES / size, UINT64_C(1));
+        static uint8_t *arena;
+        size_t offset = 0;
+        CSipHash state;
+
+        if (!arena) {
+                arena = malloc(BENCH_BYTES);
+                c_assert(arena);
+                memset(arena, 0, BENCH_BYTES);
+        }
+
+        start = bench_now();
+        for (i = 0; i < n; ++i, offset = (offset + size) % (BENCH_BYTES - size + 1)) {
+                memcpy(arena + offset, bench_data, size);
+                c_siphash_init(&state, bench_seed);
+                c_siphash_append(&state, arena + offset, size);
+                bench_sink += c_siphash_finalize(&state);
+        }
+        bench_report("memcpy() + c_siphash_append()", size, bench_now() - start, n * size);
+
+        start = bench_now();
+        for (i = 0; i < n; ++i, offset = (offset + size) % (BENCH_BYTES - size + 1)) {
+                c_siphash_init(&state, bench_seed);
+                c_siphash_append_copy(&state, arena + offset, bench_data, size);
+                bench_sink += c_siphash_finalize(&state);
+        }
+        bench_report("c_siphash_append_copy()", size, bench_now() - start, n * size);
+}
+
+/*
+ * Hash the buffer in chunks of 56 bytes. This keeps the stream aligned to
+ * 64bit, but never hands more than 64 bytes to c_siphash_append() at once,
+ * so it measures the plain word loop.
+ */
+static void bench_append_words(size_t size) {
+        uint64_t start, i, n = c_max(BENCH_BYTES / size, UINT64_C(1));
+        CSipHash state;
+        size_t j;
+
+        start = bench_now();
+        for (i = 0; i < n; ++i) {
+                c_siphash_init(&state, bench_seed);
+                for (j = 0; j < size; j += 56)
+                        c_siphash_append(&state, bench_data + j, c_min(size - j, (size_t)56));
+                bench_sink += c_siphash_finalize(&state);
+        }
+        bench_report("c_siphash_append(56)", size, bench_now() - start, n * size);
+}
+
+int main(int argc, char **argv) {
+        static const size_t sizes[] = { 8, 16, 64, 256, 4096, 65536, 1024 * 1024, sizeof(bench_data) };
+        size_t i;
+
+        for (i = 0; i < sizeof(bench_data); ++i)
+                bench_data[i] = i * 37 + 11;
+
+        for (i = 0; i < C_ARRAY_SIZE(sizes); ++i)
+                bench_hash(sizes[i]);
+        for (i = 0; i < C_ARRAY_SIZE(sizes); ++i)
+                bench_hash13(sizes[i]);
+        for (i = 0; i < C_ARRAY_SIZE(sizes); ++i)
+                bench_hash_half(sizes[i]);
+        for (i = 0; i < C_ARRAY_SIZE(sizes); ++i)
+                bench_append_words(sizes[i]);
+
+        bench_fixed();
+
+        bench_batch(4096);
+        bench_batch(65536);
+
+        bench_column_varlen(65536);
+        bench_column_fixed();
+
+        bench_strided(12);
+        bench_strided(16);
+        bench_strided(32);
+
+        bench_rows();
+
+        bench_multikey(16);
+        bench_multikey(256);
+
+        bench_fragments();
+
+        bench_str();
+
+        bench_casefold(16);
+        bench_casefold(64);
+        bench_casefold(256);
+
+        bench_prefixes(2);
+        bench_prefixes(4);
+        bench_prefixes(16);
+
+        bench_from(8);
+        bench_from(24);
+
+        bench_copy(4096);
+        bench_copy(65536);
+        bench_copy(1024 * 1024);
+        bench_copy(sizeof(bench_data));
+
+        return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * Tests for Column Hashing
+ * This test hashes columns in the supported layouts and verifies the results
+ * match hashing each row on its own. All tests are run with every
+ * implementation the CPU supports.
+ */
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <endian.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-siphash.h"
+#include "c-siphash-private.h"
+
+static const uint8_t test_seed[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                       0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+static uint8_t test_data[64 * 1024];
+
+static void test_varlen(void) {
+        static uint32_t offsets[1001];
+        static uint64_t hashes[1000];
+        static uint8_t validity[1000 / 8];
+        size_t i, n;
+
+        /* mixed lengths, starting at a non-zero offset as in sliced columns */
+        offsets[0] = 3;
+        for (i = 0; i < C_ARRAY_SIZE(hashes); ++i)
+                offsets[i + 1] = offsets[i] + (i * i * 7) % 61;
+
+        for (n = 0; n <= C_ARRAY_SIZE(hashes); n += (n < 20) ? 1 : 97) {
+                memset(hashes, 0, sizeof(hashes));
+                c_siphash_hash_column_varlen(test_seed, test_data, offsets, n, NULL, hashes);
+                for (i = 0; i < n; ++i)
+                        c_assert(hashes[i] == c_siphash_hash(test_seed,
+                                                             test_data + offsets[i],
+                                                             offsets[i + 1] - offsets[i]));
+        }
+
+        /* every third row is null */
+        for (i = 0; i < C_ARRAY_SIZE(hashes); ++i)
+                if (i % 3)
+                        validity[i / 8] |= 1U << (i % 8);
+
+        c_siphash_hash_column_varlen(test_seed, test_data, offsets, C_ARRAY_SIZE(hashes), validity, hashes);
+        for (i = 0; i < C_ARRAY_SIZE(hashes); ++i) {
+                if (i % 3)
+                        c_assert(hashes[i] == c_siphash_hash(test_seed,
+                                                             test_data + offsets[i],
+                                                             offsets[i + 1] - offsets[i]));
+                else
+                        c_assert(hashes[i] == C_SIPHASH_COLUMN_NULL_HASH);
+        }
+
+        /* all rows null */
+        memset(validity, 0, sizeof(validity));
+        c_siphash_hash_column_varlen(test_seed, test_data, offsets, C_ARRAY_SIZE(hashes), validity, hashes);
+        for (i = 0; i < C_ARRAY_SIZE(hashes); ++i)
+                c_assert(hashes[i] == C_SIPHASH_COLUMN_NULL_HASH);
+}
+
+static void test_fixed(void) {
+        static uint64_t values64[1000], hashes[1000];
+        static uint32_t values32[1000];
+        size_t i, n;
+
+        for (i = 0; i < C_ARRAY_SIZE(values64); ++i) {
+                values64[i] = i * 0x9e3779b97f4a7c15ULL;
+                values32[i] = values64[i] >> 17;
+        }
+
+        /* every column size up to a few iterations, to cover all tails */
+        for (n = 0; n <= C_ARRAY_SIZE(values64); n += (n < 40) ? 1 : 89) {
+                memset(hashes, 0, sizeof(hashes));
+                c_siphash_hash_column_u64(test_seed, values64, n, hashes);
+                for (i = 0; i < n; ++i)
+                        c_assert(hashes[i] == c_siphash_hash_u64(test_seed, values64[i]));
+                for ( ; i < C_ARRAY_SIZE(hashes); ++i)
+                        c_assert(hashes[i] == 0);
+
+                memset(hashes, 0, sizeof(hashes));
+                c_siphash_hash_column_u32(test_seed, values32, n, hashes);
+                for (i = 0; i < n; ++i)
+                        c_assert(hashes[i] == c_siphash_hash_u32(test_seed, values32[i]));
+                for ( ; i < C_ARRAY_SIZE(hashes); ++i)
+                        c_assert(hashes[i] == 0);
+        }
+
+        /* unaligned columns */
+        c_siphash_hash_column_u32(test_seed, values32 + 1, 99, hashes);
+        for (i = 0; i < 99; ++i)
+                c_assert(hashes[i] == c_siphash_hash_u32(test_seed, values32[i + 1]));
+}
+
+static void test_strided(void) {
+        static const struct {
+                size_t stride;
+                size_t offset;
+                size_t len;
+        } layouts[] = {
+                {  8, 0,  8 },
+                { 12, 4,  8 },
+                { 24, 3, 16 },
+                { 24, 5, 13 },
+                { 40, 8, 32 },
+                {  7, 2,  5 },
+                {  3, 1,  0 },
+        };
+        static uint64_t hashes[300];
+        size_t i, l, n, size;
+        uint8_t *records;
+
+        for (l = 0; l < C_ARRAY_SIZE(layouts); ++l) {
+                for (n = 0; n <= C_ARRAY_SIZE(hashes); n += (n < 40) ? 1 : 37) {
+                        /*
+                         * Allocate the exact size of the array, so reads past
+                         * the last field are caught by memory checkers.
+                         */
+                        size = n * layouts[l].stride;
+                        records = malloc(size + !size);
+                        c_assert(records);
+                        memcpy(records, test_data, size);
+
+                        c_siphash_hash_strided(test_seed,
+                                               records,
+                                               layouts[l].stride,
+                                               layouts[l].offset,
+                                               layouts[l].len,
+                                               n,
+                                               hashes);
+                        for (i = 0; i < n; ++i)
+                                c_assert(hashes[i] == c_siphash_hash(test_seed,
+                                                                     records + i * layouts[l].stride + layouts[l].offset,
+                                                                     layouts[l].len));
+
+                        free(records);
+                }
+        }
+}
+
+/*
+ * Hash rows of a composite key of all supported field kinds, and compare the
+ * result to hashing the encoding of each row, as defined by the API.
+ */
+static void test_rows(void) {
+        static uint32_t offsets[201];
+        static uint64_t hashes[200];
+        static uint8_t encoding[256];
+        CSipHashColumn columns[] = {
+                { .data = test_data, .width = 4 },
+                { .data = test_data + 1024, .width = 8 },
+                { .data = test_data + 4096, .offsets = offsets },
+                { .data = test_data + 8192, .width = 3 },
+                { .data = test_data + 12288, .width = 1 },
+                { .data = test_data + 16384, .width = 2 },
+                { .data = test_data + 20480, .width = 16 },
+        };
+        size_t i, c, n, len, n_encoding;
+
+        for (i = 0; i < C_ARRAY_SIZE(hashes); ++i)
+                offsets[i + 1] = offsets[i] + (i * 13) % 29;
+
+        for (n = 0; n <= C_ARRAY_SIZE(hashes); n += (n < 70) ? 1 : 43) {
+                c_siphash_hash_rows(test_seed, columns, C_ARRAY_SIZE(columns), n, hashes);
+
+                for (i = 0; i < n; ++i) {
+                        n_encoding = 0;
+
+                        for (c = 0; c < C_ARRAY_SIZE(columns); ++c) {
+                                if (columns[c].offsets) {
+                                        len = offsets[i + 1] - offsets[i];
+                                        memcpy(encoding + n_encoding, &(uint64_t){ htole64(len) }, 8);
+                                        memcpy(encoding + n_encoding + 8, columns[c].data + offsets[i], len);
+                                        n_encoding += 8 + len;
+                                } else {
+                                        memcpy(encoding + n_encoding,
+                                               columns[c].data + i * columns[c].width,
+                                               columns[c].width);
+                                        n_encoding += columns[c].width;
+                                }
+                        }
+
+                        c_assert(hashes[i] == c_siphash_hash(test_seed, encoding, n_encoding));
+                }
+        }
+
+        /* without columns, every row is empty */
+        c_siphash_hash_rows(test_seed, NULL, 0, 3, hashes);
+        for (i = 0; i < 3; ++i)
+                c_assert(hashes[i] == c_siphash_hash(test_seed, NULL, 0));
+}
+
+int main(int argc, char *argv[]) {
+        const CSipHashImpl *impl;
+        size_t i;
+
+        for (i = 0; i < sizeof(test_data); ++i)
+                test_data[i] = i * 37 + 11;
+
+        for (i = 0; i < c_siphash_n_impls; ++i) {
+                impl = &c_siphash_impls[i];
+                if (!impl->supported()) {
+                        fprintf(stderr, "Skipping unsupported implementation: %s\n", impl->name);
+                        continue;
+                }
+
+                c_siphash_impl_set(impl);
+
+                test_varlen();
+                test_fixed();
+                test_strided();
+                test_rows();
+        }
+
+        return 0;
+}
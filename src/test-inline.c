@@ -0,0 +1,58 @@
+/*
+ * Tests for Inline API
+ * This test builds against the header in C_SIPHASH_INLINE mode, where the
+ * core API is provided as static inline functions, and verifies they produce
+ * the reference hashes without calling into the library.
+ */
+
+#undef NDEBUG
+#define C_SIPHASH_INLINE
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-siphash.h"
+
+/* See https://131002.net/siphash/siphash.pdf, Appendix A. */
+static void test_reference(void) {
+        const uint8_t in[15]  = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e };
+        const uint8_t seed[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                   0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        const uint64_t vectors[16] = {
+                0x726fdb47dd0e0e31, 0x74f839c593dc67fd, 0x0d6c8009d9a94f5a, 0x85676696d7fb7e2d,
+                0xcf2794e0277187b7, 0x18765564cd99a68d, 0xcbc9466e58fee3ce, 0xab0200f58b01d137,
+                0x93f5f5799a932462, 0x9e0082df0ba9e4b0, 0x7a5dbbc594ddb9f3, 0xf4b32f46226bada7,
+                0x751e8fbc860ee5fb, 0x14ea5627c0843d90, 0xf723ca908e7af2ee, 0xa129ca6149be45e5,
+        };
+        CSipHashKey key = C_SIPHASH_KEY_NULL;
+        CSipHash state = C_SIPHASH_NULL;
+        unsigned i;
+
+        c_siphash_init(&state, seed);
+        c_assert(state.v0 == 0x7469686173716475);
+        c_assert(state.v1 == 0x6b617f6d656e6665);
+        c_assert(state.v2 == 0x6b7f62616d677361);
+        c_assert(state.v3 == 0x7b6b696e727e6c7b);
+        c_siphash_append(&state, in, sizeof(in));
+        c_assert(c_siphash_finalize(&state) == 0xa129ca6149be45e5);
+
+        c_assert(c_siphash_hash(seed, in, sizeof(in)) == 0xa129ca6149be45e5);
+
+        c_siphash_key_init(&key, seed);
+        c_assert(c_siphash_hash_key(&key, in, sizeof(in)) == 0xa129ca6149be45e5);
+
+        /* every prefix of the message, against the vectors of the paper */
+        for (i = 0; i <= sizeof(in); ++i) {
+                c_siphash_init_key(&state, &key);
+                c_siphash_append(&state, in, i);
+                c_assert(c_siphash_finalize(&state) == vectors[i]);
+                c_assert(c_siphash_hash(seed, in, i) == vectors[i]);
+        }
+}
+
+int main(int argc, char *argv[]) {
+        test_reference();
+        return 0;
+}